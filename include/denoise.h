@@ -0,0 +1,43 @@
+#ifndef DENOISE_H
+#define DENOISE_H
+
+// Edge-preserving smoothing interface
+
+#include <iostream>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// performs bilateral filtering on a downsampled 3-D bilateral grid (Paris - Durand)
+// `sigmaSpace` is in pixels and `sigmaRange` in grey levels; both also set the grid
+// sampling, so the cost per pixel is roughly independent of `sigmaSpace`; the grid is capped
+// at 2^24 cells by sampling it more coarsely in space, so small sigmas on large images smooth
+// over more than `sigmaSpace`
+// takes and returns CV_8UC1, throws on other types
+cv::Mat bilateral(const cv::Mat&, double, double);
+
+// performs non-local means denoising with integral images of patch distances (Darbon et al.)
+// every pixel is averaged with the pixels of the `searchSize` x `searchSize` window around it,
+// weighted by exp(-d / h^2), with d the mean squared difference of their `patchSize` x `patchSize`
+// patches; the cost per pixel is proportional to searchSize^2 and independent of `patchSize`
+// `h` is in grey levels, about the standard deviation of the noise; takes and returns CV_8UC1,
+// throws on other types
+cv::Mat nonLocalMeans(const cv::Mat&, double, int = 15, int = 5);
+
+// performs guided filtering (He et al.) of the CV_8UC1 `target`, guided by `guide`
+// `guide` is CV_8UC1 (the target itself for edge-preserving smoothing) or CV_8UC3, in which
+// case the local linear model is fitted on the three channels jointly
+// `radius` is the half-size of the box windows and `eps` the regularization, on the [0, 1]
+// intensity scale (about the squared contrast of the edges to keep); box means are running
+// sums, so the cost does not depend on `radius`
+// with `subsample` > 1 the model is fitted on images reduced by that factor and upsampled
+// bilinearly before being applied to the full-resolution guide (fast guided filter)
+cv::Mat guidedFilter(const cv::Mat&, const cv::Mat&, int, double, int = 1);
+
+// enhances the details of CV_8UC1 `image` by scaling its difference to the self-guided
+// filtered image by `amount`: base + amount * (image - base); `amount` > 1 sharpens
+cv::Mat guidedEnhance(const cv::Mat&, int, double, double, int = 1);
+
+#endif // DENOISE_H
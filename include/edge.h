@@ -0,0 +1,22 @@
+#ifndef EDGE_H
+#define EDGE_H
+
+// Edge detection interface
+
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "filt.h"
+
+// Canny edge detection of a CV_8UC1 image, returned as CV_8UC1 with edges at 255
+// the image is smoothed by a Gaussian of standard deviation `sigma` (none if 0), then
+// differentiated with SOBEL_H_3 and SOBEL_V_3 without clamping; pixels whose gradient
+// magnitude is a local maximum across the edge are kept if above `highThreshold`, or if
+// above `lowThreshold` and connected to such a pixel
+// thresholds apply to the magnitude of the (SOBEL_H_3, SOBEL_V_3) response, about twice the
+// height of a sharp step in grey levels
+cv::Mat canny(const cv::Mat&, double, double, double = 1.4);
+
+#endif // EDGE_H
@@ -4,102 +4,218 @@
 #define _CRT_SECURE_NO_WARNINGS
 #include <iostream>
 #include <algorithm>
+#include <array>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <opencv2/opencv.hpp>
 #include <Windows.h>
+#include "freqfilt.h"
+#include "parallel.h"
 
-using Vec2d = std::vector<std::vector<double>>;
-using Vec3d = std::vector<Vec2d>;
+// coefficients of a built-in N x N kernel (row-major)
+template <int N>
+using Coeffs = std::array<double, N * N>;
 
 // filter declaration
 
 // high pass
-extern std::vector<double> HIGH_PASS;
+extern const Coeffs<3> HIGH_PASS;
 // /high pass
 
 // mean
-extern std::vector<double> MEAN_3;
-extern std::vector<double> MEAN_5;
-extern std::vector<double> MEAN_7;
-extern std::vector<double> MEAN_9;
+extern const Coeffs<3> MEAN_3;
+extern const Coeffs<5> MEAN_5;
+extern const Coeffs<7> MEAN_7;
+extern const Coeffs<9> MEAN_9;
 // /mean
 
 // prewitt
-extern std::vector<double> PREWITT_H_3;
-extern std::vector<double> PREWITT_V_3;
-extern std::vector<double> PREWITT_H_5;
-extern std::vector<double> PREWITT_V_5;
-extern std::vector<double> PREWITT_H_7;
-extern std::vector<double> PREWITT_V_7;
-extern std::vector<double> PREWITT_H_9;
-extern std::vector<double> PREWITT_V_9;
+extern const Coeffs<3> PREWITT_H_3;
+extern const Coeffs<3> PREWITT_V_3;
+extern const Coeffs<5> PREWITT_H_5;
+extern const Coeffs<5> PREWITT_V_5;
+extern const Coeffs<7> PREWITT_H_7;
+extern const Coeffs<7> PREWITT_V_7;
+extern const Coeffs<9> PREWITT_H_9;
+extern const Coeffs<9> PREWITT_V_9;
 // /prewitt
 
 // sobel
-extern std::vector<double> SOBEL_H_3;
-extern std::vector<double> SOBEL_V_3;
-extern std::vector<double> SOBEL_D_3;
-extern std::vector<double> SOBEL_H_5;
-extern std::vector<double> SOBEL_V_5;
-extern std::vector<double> SOBEL_D_5;
-extern std::vector<double> SOBEL_H_7;
-extern std::vector<double> SOBEL_V_7;
-extern std::vector<double> SOBEL_D_7;
-extern std::vector<double> SOBEL_H_9;
-extern std::vector<double> SOBEL_V_9;
-extern std::vector<double> SOBEL_D_9;
+extern const Coeffs<3> SOBEL_H_3;
+extern const Coeffs<3> SOBEL_V_3;
+extern const Coeffs<3> SOBEL_D_3;
+extern const Coeffs<5> SOBEL_H_5;
+extern const Coeffs<5> SOBEL_V_5;
+extern const Coeffs<5> SOBEL_D_5;
+extern const Coeffs<7> SOBEL_H_7;
+extern const Coeffs<7> SOBEL_V_7;
+extern const Coeffs<7> SOBEL_D_7;
+extern const Coeffs<9> SOBEL_H_9;
+extern const Coeffs<9> SOBEL_V_9;
+extern const Coeffs<9> SOBEL_D_9;
 // /sobel
 
 // laplacian
-extern std::vector<double> LAPLACIAN_3;
-extern std::vector<double> LAPLACIAN_5;
-extern std::vector<double> LAPLACIAN_7;
-extern std::vector<double> LAPLACIAN_9;
+extern const Coeffs<3> LAPLACIAN_3;
+extern const Coeffs<5> LAPLACIAN_5;
+extern const Coeffs<7> LAPLACIAN_7;
+extern const Coeffs<9> LAPLACIAN_9;
 // /laplacian
 
 // gaussian
-extern std::vector<double> GAUSSIAN_3;
-extern std::vector<double> GAUSSIAN_5;
-extern std::vector<double> GAUSSIAN_7;
-extern std::vector<double> GAUSSIAN_9;
+extern const Coeffs<3> GAUSSIAN_3;
+extern const Coeffs<5> GAUSSIAN_5;
+extern const Coeffs<7> GAUSSIAN_7;
+extern const Coeffs<9> GAUSSIAN_9;
 // /gaussian
 
 // LAPLACIAN_OF_GAUSSIAN
-extern std::vector<double> LAPLACIAN_OF_GAUSSIAN_3;
-extern std::vector<double> LAPLACIAN_OF_GAUSSIAN_5;
-extern std::vector<double> LAPLACIAN_OF_GAUSSIAN_7;
-extern std::vector<double> LAPLACIAN_OF_GAUSSIAN_9;
+extern const Coeffs<3> LAPLACIAN_OF_GAUSSIAN_3;
+extern const Coeffs<5> LAPLACIAN_OF_GAUSSIAN_5;
+extern const Coeffs<7> LAPLACIAN_OF_GAUSSIAN_7;
+extern const Coeffs<9> LAPLACIAN_OF_GAUSSIAN_9;
 // /LAPLACIAN_OF_GAUSSIAN
 
 extern const char* FILTER_NAME[11];
 
-extern Vec2d MEAN;
-extern Vec2d PREWITT_H;
-extern Vec2d PREWITT_V;
-extern Vec2d SOBEL_H;
-extern Vec2d SOBEL_V;
-extern Vec2d SOBEL_D;
-extern Vec2d LAPLACIAN;
-extern Vec2d GAUSSIAN;
-extern Vec2d LAPLACIAN_OF_GAUSSIAN;
-extern Vec3d FILTERS;
+// FILTERS[filterType][filterSize] points to the coefficients of a built-in kernel
+// of size (filterSize * 2 + 3), or is nullptr for NONE and MEDIAN
+extern const double* const FILTERS[11][4];
 
 // filter declaration ends
 
+// convolution routine specialized at compile time for one built-in kernel and one pair of
+// input and output depths, applied to a band of rows [rowBegin, rowEnd)
+using SpecializedConv = void (*)(const cv::Mat&, cv::Mat&, int, int);
+
+// ways of evaluating Kernel::conv; CONV_AUTO picks the cheapest one for the kernel and image size
+enum ConvStrategy { CONV_AUTO, CONV_DIRECT, CONV_SEPARABLE, CONV_FFT };
+
+// reusable scratch memory of the filters
+// passing the same workspace and destination to repeated calls on images of the same size
+// lets them run without heap allocations once the buffers have grown
+// a workspace must not be used by two calls at the same time
+class FilterWorkspace {
+	std::vector<std::vector<double>> threadScratch;               // one buffer per pool thread
+	std::vector<double> imageScratch;                             // intermediate image shared by the call
+	CMatrix paddedScratch;                                        // padded image of CONV_FFT
+
+	// grows `storage` to hold `count` elements of type T
+	template <class T>
+	static T* grow(std::vector<double>& storage, size_t count) {
+		size_t words = (count * sizeof(T) + sizeof(double) - 1) / sizeof(double);
+		if (storage.size() < words) storage.resize(words);
+		return reinterpret_cast<T*>(storage.data());
+	}
+
+public:
+	// makes room for `count` elements of type T in the scratch of every pool thread
+	// called before a parallel run, so that no buffer grows while it is in flight;
+	// a nested run stays on the calling thread, which then is the only one to need room
+	template <class T>
+	void reserve(size_t count) {
+		size_t threads = getNumThreads();
+		if (threadScratch.size() < threads) threadScratch.resize(threads);
+		if (insideParallelFor()) {
+			grow<T>(threadScratch[getThreadIndex()], count);
+			return;
+		}
+		for (auto& storage : threadScratch) grow<T>(storage, count);
+	}
+
+	// scratch reserved for pool thread `thread`, with unspecified contents
+	template <class T>
+	T* scratch(int thread) {
+		return reinterpret_cast<T*>(threadScratch[thread].data());
+	}
+
+	// scratch of `count` elements shared by the whole call, with unspecified contents
+	template <class T>
+	T* buffer(size_t count) {
+		return grow<T>(imageScratch, count);
+	}
+
+	// rows x cols complex matrix of zeros, reallocated only when it has to grow
+	CMatrix& padded(int rows, int cols);
+};
+
 // creating different kernels
 class Kernel { 
 	int size;
 	std::vector<double> matrix;
+	int builtin;             // built-in kernel `matrix` matches (filterType * 4 + filterSize), or -1
+	int taps;                // number of non-zero coefficients
+	std::vector<double> rowFactor, colFactor; // rank-1 factors (matrix = colFactor x rowFactor), empty if not separable
+	bool exactFactors;       // the factors reproduce the matrix up to double rounding, not only to 8 decimals
+	std::shared_ptr<const CMatrix> spectrum; // cached for CONV_FFT
+
+	void prepare();
+	template <class In, class Out> void convRows(const cv::Mat&, cv::Mat&, int, int);
+	template <class In, class Out> void convSeparable(const cv::Mat&, cv::Mat&, FilterWorkspace&);
+	template <class In, class Out> void convFFT(const cv::Mat&, cv::Mat&, FilterWorkspace&);
+	template <class In, class Out> void convTyped(const cv::Mat&, cv::Mat&, ConvStrategy, FilterWorkspace&);
 
 public:
 	Kernel();
-	Kernel(int, std::vector<double>&);
+	Kernel(int, const std::vector<double>&);
+	Kernel(int, const double*);
 	Kernel(int, int);
-	double at(int, int);
-	cv::Mat conv(cv::Mat&);
+	int getSize() const;
+	double at(int, int) const;
+	bool isSeparable() const;
+	// strategy chosen by CONV_AUTO for a rows x cols image of the given depth, into results of
+	// the given depth (-1 for the depth of the image)
+	ConvStrategy pickStrategy(int, int, int = CV_8U, int = -1) const;
+
+	// takes CV_8U, CV_16S, CV_32F or CV_64F images of 1, 3 or 4 interleaved channels
+	// 8-bit results are clamped to 0-255; wider results are not, so filters can be chained
+	// without losing precision and brought back to 8 bits once with saturate()
+	cv::Mat conv(const cv::Mat&, ConvStrategy = CONV_AUTO);      // result of the same depth as the image
+	cv::Mat conv(const cv::Mat&, int, ConvStrategy = CONV_AUTO); // result of the given depth
+
+	// convolves into a destination, reallocated only if its size or type does not match
+	// the depth defaults (-1) to the depth of the image; the destination must not share its data
+	void conv(const cv::Mat&, cv::Mat&, FilterWorkspace&, int = -1, ConvStrategy = CONV_AUTO);
+};
+
+// clamps a convolution result of any depth to CV_8U, the way an 8-bit conv stores it
+cv::Mat saturate(const cv::Mat&);
+
+// evaluates several kernels in a single pass over the image
+// every neighbourhood is loaded once and shared by all the kernels
+class FilterBank {
+	int size; // size of the largest kernel
+
+	// non-zero taps of every kernel, as (offset in the size x size window, coefficient)
+	std::vector<std::vector<std::pair<int, double>>> taps;
+
+public:
+	FilterBank(const std::vector<Kernel>&);
+	FilterBank(const std::vector<int>&, int); // built-in filter types of a common filter size
+
+	// signed 16-bit response of every kernel of CV_8UC1 image, without clamping to 0-255
+	// optionally also the gradient magnitude and orientation (radians, CV_32F)
+	// taking the first two kernels as the horizontal and vertical derivatives
+	// throws on other image types, and on a gradient asked of fewer than two kernels
+	std::vector<cv::Mat> apply(const cv::Mat&, cv::Mat* = nullptr, cv::Mat* = nullptr);
 };
 
-cv::Mat median(cv::Mat&, int);                       // performs median filtering
-cv::Mat adaptiveHighBoost(cv::Mat&, double, double); // performs adaptive HB filtering
+// both take 8-bit images of 1 to 4 interleaved channels and filter every channel independently,
+// in a single pass; both throw on any other type
+cv::Mat median(const cv::Mat&, int, double = 0.5);         // performs median (or percentile) filtering
+cv::Mat adaptiveHighBoost(const cv::Mat&, double, double); // performs adaptive HB filtering
+
+// the same, into a destination reallocated only if its size or type does not match
+void median(const cv::Mat&, cv::Mat&, FilterWorkspace&, int, double = 0.5);
+void adaptiveHighBoost(const cv::Mat&, cv::Mat&, double, double);
+
+// performs Gaussian smoothing of any sigma with recursive (Young - van Vliet) filters,
+// optionally followed by a derivative of order 1 or 2 along x (columns) and y (rows)
+// borders are extended with their edge values; the cost per pixel does not depend on sigma
+// takes CV_8UC1 or CV_32FC1 and throws on other types, returns CV_32FC1
+cv::Mat recursiveGaussian(const cv::Mat&, double, int = 0, int = 0);
 
 #endif // FILT_H
\ No newline at end of file
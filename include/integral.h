@@ -0,0 +1,46 @@
+#ifndef INTEGRAL_H
+#define INTEGRAL_H
+
+// Summed-area tables and windowed local statistics
+
+#include <iostream>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// summed-area tables of the values and squared values of a CV_8UC1 image
+// the tables are 64-bit, so any image that fits in memory is summed without overflow
+class IntegralImage {
+	int rows, cols;
+	std::vector<uint64_t> sums;    // (rows + 1) x (cols + 1), first row and column are zero
+	std::vector<uint64_t> squares; // same layout, over the squared values
+
+	size_t index(int i, int j) const {
+		return static_cast<size_t>(i) * (cols + 1) + j;
+	}
+
+public:
+	IntegralImage();
+	IntegralImage(const cv::Mat&);
+
+	// (re)builds the tables for `image`, reusing their memory; throws unless it is CV_8UC1
+	void compute(const cv::Mat&);
+
+	int getRows() const { return rows; }
+	int getCols() const { return cols; }
+
+	// sum and sum of squares over rows [top, bottom) and columns [left, right)
+	uint64_t sum(int top, int left, int bottom, int right) const {
+		return sums[index(bottom, right)] - sums[index(top, right)] - sums[index(bottom, left)] + sums[index(top, left)];
+	}
+	uint64_t sumOfSquares(int top, int left, int bottom, int right) const {
+		return squares[index(bottom, right)] - squares[index(top, right)] - squares[index(bottom, left)] + squares[index(top, left)];
+	}
+
+	// mean and variance of the `size` x `size` window centred at (i, j), clipped to the image
+	void windowStats(int i, int j, int size, double& mean, double& variance) const;
+};
+
+#endif // INTEGRAL_H
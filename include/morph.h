@@ -6,11 +6,13 @@
 #include <iostream>
 #include <vector>
 #include <opencv2/opencv.hpp>
+#include "integral.h"
 
 #define X first
 #define Y second
 
 extern const int BINARY_THRESHOLD;
+extern const double SAUVOLA_RANGE;
 extern std::vector<std::string> OP_NAME;
 extern std::vector<std::string> STRUCT_ELEM_NAME;
 extern const std::vector<std::vector<std::pair<int, int>>> STEPS;
@@ -22,4 +24,13 @@ inline bool isValid(int x, int y, int rx, int ry) {
 void apply(cv::Mat&, int, bool = false, int = 0);
 void binary(cv::Mat&);
 
+// local threshold T(i, j) of adaptiveBinary, from the mean m and standard deviation s of the window
+enum ThresholdMethod {
+	ADAPTIVE_MEAN_C,   // T = m - k
+	ADAPTIVE_NIBLACK,  // T = m + k * s
+	ADAPTIVE_SAUVOLA   // T = m * (1 + k * (s / SAUVOLA_RANGE - 1))
+};
+
+void adaptiveBinary(cv::Mat&, ThresholdMethod, int, double);
+
 #endif // MORPH_H
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+// Thread pool shared by the image processing routines
+
+#include <algorithm>
+
+// the number of threads may change at any time, from any thread; calls already running finish
+// on the pool they started on, and the parallelFor calls of a thread run on at most as many
+// threads as getNumThreads() last returned to it, so scratch sized by it stays large enough
+void setNumThreads(int); // 0 selects one thread per hardware thread
+int getNumThreads();
+
+// index in [0, getNumThreads()) of the pool thread running the current chunk;
+// the thread that called parallelFor (or any thread outside the pool) is 0
+int getThreadIndex();
+
+// true while the calling thread runs a chunk of a parallelFor, where nested calls run serially
+bool insideParallelFor();
+
+// splits [begin, end) into chunks of at least `grain` indices and runs
+// `body(ctx, chunkBegin, chunkEnd)` over them on the thread pool, returning
+// once every chunk is done; nested calls run serially on the calling thread
+void parallelForImpl(int, int, void (*)(void*, int, int), void*, int);
+
+// runs `body(chunkBegin, chunkEnd)` over [begin, end) on the thread pool
+// chunks are disjoint, so bodies writing only their own indices give the
+// same result for any thread count
+template <class Body>
+void parallelFor(int begin, int end, const Body& body, int grain = 1) {
+	auto call = [](void* ctx, int chunkBegin, int chunkEnd) {
+		(*static_cast<const Body*>(ctx))(chunkBegin, chunkEnd);
+	};
+	parallelForImpl(begin, end, call, const_cast<Body*>(&body), std::max(grain, 1));
+}
+
+#endif // PARALLEL_H
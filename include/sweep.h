@@ -0,0 +1,33 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+// Headless sweep of the spatial filters over a corpus of images
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// one image x filter type x filter size combination of a sweep
+struct SweepResult {
+	int file;             // index in the list of files
+	int filterType;       // index in FILTER_NAME
+	int filterSize;       // kernel of size (filterSize * 2 + 3)
+	double milliseconds;  // time spent filtering, on one thread
+	unsigned long long checksum; // FNV-1a hash of the output pixels, to compare runs
+};
+
+// runs every filter type x filter size over every image, as the GUI tests would
+// each image is read (as grey-scale) once, ahead of the filtering, and the grids of combinations
+// of the images read so far are filtered in one parallel run; results stay in file order;
+// outputs are written as `<file>_<filterType>_<filterSize>.jpg` into `outputDirectory` by a
+// background thread, or not at all if the directory is empty
+// unreadable files are reported on std::cerr and skipped
+std::vector<SweepResult> sweep(const std::vector<std::string>&, const std::string& = "",
+                               const std::vector<int>& = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 },
+                               const std::vector<int>& = { 0, 1, 2, 3 });
+
+// prints the timing table of a sweep, one line per combination
+void printSweep(std::ostream&, const std::vector<SweepResult>&, const std::vector<std::string>&);
+
+#endif // SWEEP_H
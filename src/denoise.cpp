@@ -0,0 +1,498 @@
+// Edge-preserving smoothing implementation
+
+#include "denoise.h"
+#include "parallel.h"
+
+// empty cells around the data, so that the blur can spread past the image borders
+static const int GRID_PAD = 2;
+
+// image rows per parallel task when slicing
+static const int ROW_BAND = 16;
+
+// most cells of a bilateral grid, about 128 MB per grid; finer samplings are coarsened in space
+static const size_t MAX_GRID_CELLS = size_t(1) << 24;
+
+// 3-D grid of (weighted intensity sum, weight) pairs, indexed [y][x][z]
+// with y and x the downsampled pixel position and z the downsampled intensity
+struct BilateralGrid {
+	int height, width, depth;
+	std::vector<float> cells;
+
+	BilateralGrid(int height, int width, int depth)
+		: height(height), width(width), depth(depth), cells(2 * size(height, width, depth), 0.0f) {}
+
+	// number of cells of a height x width x depth grid
+	static size_t size(int height, int width, int depth) {
+		return static_cast<size_t>(height) * width * depth;
+	}
+
+	float* at(int y, int x, int z) {
+		return &cells[2 * ((static_cast<size_t>(y) * width + x) * depth + z)];
+	}
+};
+
+// blurs `src` into `dst` with the binomial kernel [1 4 6 4 1] / 16 along `axis` (0 = y, 1 = x, 2 = z)
+static void blurAxis(const BilateralGrid& src, BilateralGrid& dst, int axis) {
+	static const float WEIGHTS[5] = { 1 / 16.0f, 4 / 16.0f, 6 / 16.0f, 4 / 16.0f, 1 / 16.0f };
+	const int length[3] = { src.height, src.width, src.depth };
+	const ptrdiff_t stride[3] = { 2 * static_cast<ptrdiff_t>(src.width) * src.depth, 2 * static_cast<ptrdiff_t>(src.depth), 2 };
+	parallelFor(0, src.height, [&](int yBegin, int yEnd) {
+		for (int y = yBegin; y < yEnd; y++) {
+			for (int x = 0; x < src.width; x++) {
+				for (int z = 0; z < src.depth; z++) {
+					int c = (axis == 0) ? y : (axis == 1) ? x : z;
+					size_t cell = 2 * ((static_cast<size_t>(y) * src.width + x) * src.depth + z);
+					float sum = 0, weight = 0;
+					for (int k = std::max(-2, -c); k <= std::min(2, length[axis] - 1 - c); k++) {
+						const float* neighbour = &src.cells[cell + k * stride[axis]];
+						sum += WEIGHTS[k + 2] * neighbour[0];
+						weight += WEIGHTS[k + 2] * neighbour[1];
+					}
+					dst.cells[cell] = sum;
+					dst.cells[cell + 1] = weight;
+				}
+			}
+		}
+	});
+}
+
+/**
+* performs bilateral filtering of `image` in three steps
+* splat:  every pixel is added with trilinear weights to the 8 grid cells around
+*         (row / sigmaSpace, col / sigmaSpace, intensity / sigmaRange)
+* blur:   the grid is convolved with a Gaussian of one cell along each axis
+* slice:  the output is the grid value interpolated at the pixel's position,
+*         normalized by the interpolated weight
+* the grid holds about (rows * cols) / sigmaSpace^2 * 256 / sigmaRange cells, so for
+* larger sigmas the blur gets cheaper while splatting and slicing stay linear in pixels
+* grids above MAX_GRID_CELLS are sampled more coarsely in space, which widens the spatial
+* Gaussian to the cell size
+*/
+cv::Mat bilateral(const cv::Mat& image, double sigmaSpace, double sigmaRange) {
+	if (image.type() != CV_8UC1) throw std::runtime_error("bilateral takes CV_8UC1 images!");
+	int rows = image.rows;
+	int cols = image.cols;
+	cv::Mat result(rows, cols, CV_8UC1);
+	if (rows == 0 || cols == 0) return result;
+	double spaceCell = std::max(sigmaSpace, 1.0);
+	double rangeCell = std::max(sigmaRange, 1.0);
+
+	int depth = static_cast<int>(255 / rangeCell) + 2 + 2 * GRID_PAD;
+	auto cellsAlong = [](int pixels, double cell) { return static_cast<int>((pixels - 1) / cell) + 2 + 2 * GRID_PAD; };
+	while (BilateralGrid::size(cellsAlong(rows, spaceCell), cellsAlong(cols, spaceCell), depth) > MAX_GRID_CELLS) {
+		spaceCell *= 1.05;
+	}
+	BilateralGrid grid(cellsAlong(rows, spaceCell), cellsAlong(cols, spaceCell), depth);
+
+	// splat, in bands of grid rows; every band reads the pixel rows that reach it
+	parallelFor(0, grid.height, [&](int yBegin, int yEnd) {
+		int rowBegin = std::max(0, static_cast<int>((yBegin - 1 - GRID_PAD) * spaceCell));
+		int rowEnd = std::min(rows, static_cast<int>((yEnd - GRID_PAD) * spaceCell) + 1);
+		for (int i = rowBegin; i < rowEnd; i++) {
+			double y = i / spaceCell + GRID_PAD;
+			int y0 = static_cast<int>(y);
+			float fy = static_cast<float>(y - y0);
+			const uchar* row = image.ptr<uchar>(i);
+			for (int j = 0; j < cols; j++) {
+				double x = j / spaceCell + GRID_PAD;
+				double z = row[j] / rangeCell + GRID_PAD;
+				int x0 = static_cast<int>(x), z0 = static_cast<int>(z);
+				float fx = static_cast<float>(x - x0), fz = static_cast<float>(z - z0);
+				for (int dy = 0; dy <= 1; dy++) {
+					if (y0 + dy < yBegin || y0 + dy >= yEnd) continue;
+					float wy = dy ? fy : 1 - fy;
+					for (int dx = 0; dx <= 1; dx++) {
+						float wxy = wy * (dx ? fx : 1 - fx);
+						float* cell = grid.at(y0 + dy, x0 + dx, z0);
+						cell[0] += wxy * (1 - fz) * row[j];
+						cell[1] += wxy * (1 - fz);
+						cell[2] += wxy * fz * row[j];
+						cell[3] += wxy * fz;
+					}
+				}
+			}
+		}
+	});
+
+	// blur along z, x and y
+	BilateralGrid blurred(grid.height, grid.width, grid.depth);
+	blurAxis(grid, blurred, 2);
+	blurAxis(blurred, grid, 1);
+	blurAxis(grid, blurred, 0);
+
+	// slice
+	parallelFor(0, rows, [&](int rowBegin, int rowEnd) {
+		for (int i = rowBegin; i < rowEnd; i++) {
+			double y = i / spaceCell + GRID_PAD;
+			int y0 = static_cast<int>(y);
+			float fy = static_cast<float>(y - y0);
+			const uchar* row = image.ptr<uchar>(i);
+			uchar* out = result.ptr<uchar>(i);
+			for (int j = 0; j < cols; j++) {
+				double x = j / spaceCell + GRID_PAD;
+				double z = row[j] / rangeCell + GRID_PAD;
+				int x0 = static_cast<int>(x), z0 = static_cast<int>(z);
+				float fx = static_cast<float>(x - x0), fz = static_cast<float>(z - z0);
+				float sum = 0, weight = 0;
+				for (int dy = 0; dy <= 1; dy++) {
+					float wy = dy ? fy : 1 - fy;
+					for (int dx = 0; dx <= 1; dx++) {
+						float wxy = wy * (dx ? fx : 1 - fx);
+						const float* cell = blurred.at(y0 + dy, x0 + dx, z0);
+						sum += wxy * ((1 - fz) * cell[0] + fz * cell[2]);
+						weight += wxy * ((1 - fz) * cell[1] + fz * cell[3]);
+					}
+				}
+				out[j] = (weight > 0) ? cv::saturate_cast<uchar>(sum / weight) : row[j];
+			}
+		}
+	}, ROW_BAND);
+	return result;
+}
+
+// `image` padded by `pad` pixels on every side, replicating the borders
+static cv::Mat padReplicate(const cv::Mat& image, int pad) {
+	cv::Mat padded(image.rows + 2 * pad, image.cols + 2 * pad, CV_8UC1);
+	for (int i = 0; i < padded.rows; i++) {
+		const uchar* row = image.ptr<uchar>(std::min(std::max(i - pad, 0), image.rows - 1));
+		uchar* out = padded.ptr<uchar>(i);
+		for (int j = 0; j < padded.cols; j++) {
+			out[j] = row[std::min(std::max(j - pad, 0), image.cols - 1)];
+		}
+	}
+	return padded;
+}
+
+/**
+* performs non-local means denoising of `image`, one band of rows per parallel task
+* for every offset (dy, dx) of the search window, the band builds the summed-area table of
+* (I(p) - I(p + (dy, dx)))^2 over its rows plus the patch margin; the distance between the
+* patches at p and p + (dy, dx) is then one lookup of four entries, whatever the patch size
+* the centre pixel gets the largest weight of its neighbours rather than exp(0) = 1, so that
+* pixels without similar patches are still smoothed
+*/
+cv::Mat nonLocalMeans(const cv::Mat& image, double h, int searchSize, int patchSize) {
+	if (image.type() != CV_8UC1) throw std::runtime_error("nonLocalMeans takes CV_8UC1 images!");
+	int rows = image.rows;
+	int cols = image.cols;
+	cv::Mat result(rows, cols, CV_8UC1);
+	if (rows == 0 || cols == 0) return result;
+	int searchRadius = searchSize / 2;
+	int patchRadius = patchSize / 2;
+	int pad = searchRadius + patchRadius;
+	cv::Mat padded = padReplicate(image, pad);
+	// exp(-d / h^2) with d the mean over the patch, folded into one factor on the patch sum
+	float scale = static_cast<float>(-1.0 / (std::max(h * h, 1e-12) * (2 * patchRadius + 1) * (2 * patchRadius + 1)));
+
+	parallelFor(0, rows, [&](int rowBegin, int rowEnd) {
+		int bandRows = rowEnd - rowBegin;
+		int tableRows = bandRows + 2 * patchRadius + 1;
+		int tableCols = cols + 2 * patchRadius + 1;
+		std::vector<uint64_t> table(static_cast<size_t>(tableRows) * tableCols, 0);
+		std::vector<float> sum(static_cast<size_t>(bandRows) * cols, 0.0f);
+		std::vector<float> weight(sum.size(), 0.0f), maxWeight(sum.size(), 0.0f);
+
+		for (int dy = -searchRadius; dy <= searchRadius; dy++) {
+			for (int dx = -searchRadius; dx <= searchRadius; dx++) {
+				if (dy == 0 && dx == 0) continue;
+				// table row t + 1 and column c + 1 sum the squared differences up to padded row
+				// rowBegin + searchRadius + t and padded column searchRadius + c
+				for (int t = 0; t + 1 < tableRows; t++) {
+					const uchar* row = padded.ptr<uchar>(rowBegin + searchRadius + t) + searchRadius;
+					const uchar* shifted = padded.ptr<uchar>(rowBegin + searchRadius + t + dy) + searchRadius + dx;
+					const uint64_t* above = &table[static_cast<size_t>(t) * tableCols];
+					uint64_t* out = &table[static_cast<size_t>(t + 1) * tableCols];
+					uint64_t running = 0;
+					for (int c = 0; c + 1 < tableCols; c++) {
+						int d = row[c] - shifted[c];
+						running += d * d;
+						out[c + 1] = above[c + 1] + running;
+					}
+				}
+				int patch = 2 * patchRadius + 1;
+				for (int i = 0; i < bandRows; i++) {
+					const uint64_t* top = &table[static_cast<size_t>(i) * tableCols];
+					const uint64_t* bottom = &table[static_cast<size_t>(i + patch) * tableCols];
+					const uchar* neighbours = padded.ptr<uchar>(rowBegin + i + pad + dy) + pad + dx;
+					size_t base = static_cast<size_t>(i) * cols;
+					for (int j = 0; j < cols; j++) {
+						float distance = static_cast<float>(bottom[j + patch] - top[j + patch] - bottom[j] + top[j]);
+						float w = std::exp(distance * scale);
+						sum[base + j] += w * neighbours[j];
+						weight[base + j] += w;
+						maxWeight[base + j] = std::max(maxWeight[base + j], w);
+					}
+				}
+			}
+		}
+
+		for (int i = 0; i < bandRows; i++) {
+			const uchar* row = image.ptr<uchar>(rowBegin + i);
+			uchar* out = result.ptr<uchar>(rowBegin + i);
+			size_t base = static_cast<size_t>(i) * cols;
+			for (int j = 0; j < cols; j++) {
+				float centre = (maxWeight[base + j] > 0) ? maxWeight[base + j] : 1.0f;
+				out[j] = cv::saturate_cast<uchar>((sum[base + j] + centre * row[j]) / (weight[base + j] + centre));
+			}
+		}
+	}, ROW_BAND);
+	return result;
+}
+
+// planes of a guided filter, CV_32FC1 on the [0, 1] scale
+typedef std::vector<cv::Mat> Planes;
+
+// runs `body(i)` for every row of an image of `rows` rows on the thread pool
+template <class Body>
+static void forEachRow(int rows, const Body& body) {
+	parallelFor(0, rows, [&](int begin, int end) {
+		for (int i = begin; i < end; i++) body(i);
+	}, ROW_BAND);
+}
+
+// splits an 8-bit image into float planes on the [0, 1] scale
+static Planes toPlanes(const cv::Mat& image) {
+	int channels = image.channels();
+	Planes planes(channels);
+	for (auto& plane : planes) plane = cv::Mat(image.rows, image.cols, CV_32FC1);
+	forEachRow(image.rows, [&](int i) {
+		const uchar* row = image.ptr<uchar>(i);
+		for (int c = 0; c < channels; c++) {
+			float* out = planes[c].ptr<float>(i);
+			for (int j = 0; j < image.cols; j++) out[j] = row[j * channels + c] / 255.0f;
+		}
+	});
+	return planes;
+}
+
+// elementwise product of two planes
+static cv::Mat product(const cv::Mat& a, const cv::Mat& b) {
+	cv::Mat result(a.rows, a.cols, CV_32FC1);
+	forEachRow(a.rows, [&](int i) {
+		const float* x = a.ptr<float>(i);
+		const float* y = b.ptr<float>(i);
+		float* out = result.ptr<float>(i);
+		for (int j = 0; j < a.cols; j++) out[j] = x[j] * y[j];
+	});
+	return result;
+}
+
+/**
+* mean of `src` over the (2 * radius + 1)^2 box around every pixel, clipped to the image
+* rows are summed with prefix sums and columns with a window sliding down the image,
+* both in double, so the cost per pixel is constant in `radius`
+*/
+static cv::Mat boxMean(const cv::Mat& src, int radius) {
+	int rows = src.rows, cols = src.cols;
+	cv::Mat horizontal(rows, cols, CV_32FC1), result(rows, cols, CV_32FC1);
+	parallelFor(0, rows, [&](int rowBegin, int rowEnd) {
+		std::vector<double> prefix(cols + 1, 0.0);
+		for (int i = rowBegin; i < rowEnd; i++) {
+			const float* row = src.ptr<float>(i);
+			float* out = horizontal.ptr<float>(i);
+			for (int j = 0; j < cols; j++) prefix[j + 1] = prefix[j] + row[j];
+			for (int j = 0; j < cols; j++) {
+				int left = std::max(j - radius, 0), right = std::min(j + radius + 1, cols);
+				out[j] = static_cast<float>((prefix[right] - prefix[left]) / (right - left));
+			}
+		}
+	}, ROW_BAND);
+	// columns in blocks, each sliding its window of sums down the rows
+	const int COLUMN_BLOCK = 64;
+	parallelFor(0, (cols + COLUMN_BLOCK - 1) / COLUMN_BLOCK, [&](int blockBegin, int blockEnd) {
+		int first = blockBegin * COLUMN_BLOCK, last = std::min(blockEnd * COLUMN_BLOCK, cols);
+		std::vector<double> window(last - first, 0.0);
+		for (int i = 0; i < std::min(radius, rows); i++) {
+			const float* row = horizontal.ptr<float>(i);
+			for (int j = first; j < last; j++) window[j - first] += row[j];
+		}
+		for (int i = 0; i < rows; i++) {
+			if (i + radius < rows) {
+				const float* entering = horizontal.ptr<float>(i + radius);
+				for (int j = first; j < last; j++) window[j - first] += entering[j];
+			}
+			if (i - radius - 1 >= 0) {
+				const float* leaving = horizontal.ptr<float>(i - radius - 1);
+				for (int j = first; j < last; j++) window[j - first] -= leaving[j];
+			}
+			double count = std::min(i + radius + 1, rows) - std::max(i - radius, 0);
+			float* out = result.ptr<float>(i);
+			for (int j = first; j < last; j++) out[j] = static_cast<float>(window[j - first] / count);
+		}
+	}, 1);
+	return result;
+}
+
+// `src` averaged over blocks of `factor` x `factor` pixels (partial blocks at the borders)
+static cv::Mat downsample(const cv::Mat& src, int factor) {
+	cv::Mat result((src.rows + factor - 1) / factor, (src.cols + factor - 1) / factor, CV_32FC1);
+	forEachRow(result.rows, [&](int i) {
+		float* out = result.ptr<float>(i);
+		int rowEnd = std::min((i + 1) * factor, src.rows);
+		for (int j = 0; j < result.cols; j++) {
+			int colEnd = std::min((j + 1) * factor, src.cols);
+			float sum = 0;
+			for (int y = i * factor; y < rowEnd; y++) {
+				const float* row = src.ptr<float>(y);
+				for (int x = j * factor; x < colEnd; x++) sum += row[x];
+			}
+			out[j] = sum / ((rowEnd - i * factor) * (colEnd - j * factor));
+		}
+	});
+	return result;
+}
+
+// bilinear interpolation of block averages `src` back to `rows` x `cols` pixels
+static cv::Mat upsample(const cv::Mat& src, int factor, int rows, int cols) {
+	cv::Mat result(rows, cols, CV_32FC1);
+	// the block of pixel p is p / factor, centred at (block + 0.5) * factor - 0.5
+	auto locate = [&](int p, int size, int& low, float& fraction) {
+		float position = std::min(std::max((p + 0.5f) / factor - 0.5f, 0.0f), static_cast<float>(size - 1));
+		low = std::min(static_cast<int>(position), std::max(size - 2, 0));
+		fraction = position - low;
+	};
+	forEachRow(rows, [&](int i) {
+		int y0;
+		float fy;
+		locate(i, src.rows, y0, fy);
+		const float* top = src.ptr<float>(y0);
+		const float* bottom = src.ptr<float>(std::min(y0 + 1, src.rows - 1));
+		float* out = result.ptr<float>(i);
+		for (int j = 0; j < cols; j++) {
+			int x0;
+			float fx;
+			locate(j, src.cols, x0, fx);
+			int x1 = std::min(x0 + 1, src.cols - 1);
+			out[j] = (1 - fy) * ((1 - fx) * top[x0] + fx * top[x1]) + fy * ((1 - fx) * bottom[x0] + fx * bottom[x1]);
+		}
+	});
+	return result;
+}
+
+/**
+* fits the local linear model q = a . I + b of the guided filter and returns the box means
+* of the coefficients: one plane of a per guide channel, then b
+* grey guides: a = cov(I, p) / (var(I) + eps)
+* colour guides: a = (Sigma + eps U)^-1 cov(I, p), with Sigma the 3 x 3 covariance of I
+* b = mean(p) - a . mean(I) in both cases
+*/
+static Planes fitGuided(const Planes& guide, const cv::Mat& target, int radius, double eps) {
+	int rows = target.rows, cols = target.cols;
+	int channels = static_cast<int>(guide.size());
+	Planes meanI(channels), meanIp(channels);
+	for (int c = 0; c < channels; c++) {
+		meanI[c] = boxMean(guide[c], radius);
+		meanIp[c] = boxMean(product(guide[c], target), radius);
+	}
+	cv::Mat meanP = boxMean(target, radius);
+	// upper triangle of E[I_c I_d]
+	Planes meanII;
+	for (int c = 0; c < channels; c++) {
+		for (int d = c; d < channels; d++) meanII.push_back(boxMean(product(guide[c], guide[d]), radius));
+	}
+
+	Planes coefficients(channels + 1);
+	for (auto& plane : coefficients) plane = cv::Mat(rows, cols, CV_32FC1);
+	forEachRow(rows, [&](int i) {
+		for (int j = 0; j < cols; j++) {
+			double mean[3], cov[3], a[3];
+			for (int c = 0; c < channels; c++) {
+				mean[c] = meanI[c].ptr<float>(i)[j];
+				cov[c] = meanIp[c].ptr<float>(i)[j] - mean[c] * meanP.ptr<float>(i)[j];
+			}
+			if (channels == 1) {
+				double variance = meanII[0].ptr<float>(i)[j] - mean[0] * mean[0];
+				a[0] = cov[0] / (variance + eps);
+			}
+			else {
+				// symmetric Sigma + eps U, inverted through its adjugate
+				double s[3][3];
+				for (int c = 0, k = 0; c < 3; c++) {
+					for (int d = c; d < 3; d++, k++) {
+						s[c][d] = s[d][c] = meanII[k].ptr<float>(i)[j] - mean[c] * mean[d] + (c == d ? eps : 0);
+					}
+				}
+				double inverse[3][3] = {
+					{ s[1][1] * s[2][2] - s[1][2] * s[2][1], s[0][2] * s[2][1] - s[0][1] * s[2][2], s[0][1] * s[1][2] - s[0][2] * s[1][1] },
+					{ s[1][2] * s[2][0] - s[1][0] * s[2][2], s[0][0] * s[2][2] - s[0][2] * s[2][0], s[0][2] * s[1][0] - s[0][0] * s[1][2] },
+					{ s[1][0] * s[2][1] - s[1][1] * s[2][0], s[0][1] * s[2][0] - s[0][0] * s[2][1], s[0][0] * s[1][1] - s[0][1] * s[1][0] }
+				};
+				double determinant = s[0][0] * inverse[0][0] + s[0][1] * inverse[1][0] + s[0][2] * inverse[2][0];
+				for (int c = 0; c < 3; c++) {
+					a[c] = (inverse[c][0] * cov[0] + inverse[c][1] * cov[1] + inverse[c][2] * cov[2]) / determinant;
+				}
+			}
+			double b = meanP.ptr<float>(i)[j];
+			for (int c = 0; c < channels; c++) {
+				coefficients[c].ptr<float>(i)[j] = static_cast<float>(a[c]);
+				b -= a[c] * mean[c];
+			}
+			coefficients[channels].ptr<float>(i)[j] = static_cast<float>(b);
+		}
+	});
+	for (auto& plane : coefficients) plane = boxMean(plane, radius);
+	return coefficients;
+}
+
+// guided filter output q = mean(a) . I + mean(b) on the [0, 1] scale, as a float plane
+static cv::Mat guidedPlane(const cv::Mat& guide, const cv::Mat& target, int radius, double eps, int subsample) {
+	if (guide.type() != CV_8UC1 && guide.type() != CV_8UC3) {
+		throw std::runtime_error("Guide of guidedFilter must be CV_8UC1 or CV_8UC3!");
+	}
+	if (target.type() != CV_8UC1 || target.rows != guide.rows || target.cols != guide.cols) {
+		throw std::runtime_error("Target of guidedFilter must be CV_8UC1 of the size of the guide!");
+	}
+	if (guide.rows == 0 || guide.cols == 0) return cv::Mat(guide.rows, guide.cols, CV_32FC1);
+	Planes guidePlanes = toPlanes(guide);
+	cv::Mat targetPlane = toPlanes(target)[0];
+	int channels = static_cast<int>(guidePlanes.size());
+	Planes coefficients;
+	if (subsample > 1) {
+		Planes small(channels);
+		for (int c = 0; c < channels; c++) small[c] = downsample(guidePlanes[c], subsample);
+		coefficients = fitGuided(small, downsample(targetPlane, subsample), std::max(radius / subsample, 1), eps);
+		for (auto& plane : coefficients) plane = upsample(plane, subsample, guide.rows, guide.cols);
+	}
+	else {
+		coefficients = fitGuided(guidePlanes, targetPlane, radius, eps);
+	}
+
+	cv::Mat result(guide.rows, guide.cols, CV_32FC1);
+	forEachRow(guide.rows, [&](int i) {
+		float* out = result.ptr<float>(i);
+		for (int j = 0; j < guide.cols; j++) {
+			float q = coefficients[channels].ptr<float>(i)[j];
+			for (int c = 0; c < channels; c++) q += coefficients[c].ptr<float>(i)[j] * guidePlanes[c].ptr<float>(i)[j];
+			out[j] = q;
+		}
+	});
+	return result;
+}
+
+// performs guided filtering of `target` with `guide`
+cv::Mat guidedFilter(const cv::Mat& guide, const cv::Mat& target, int radius, double eps, int subsample) {
+	cv::Mat q = guidedPlane(guide, target, radius, eps, subsample);
+	cv::Mat result(q.rows, q.cols, CV_8UC1);
+	forEachRow(q.rows, [&](int i) {
+		const float* row = q.ptr<float>(i);
+		uchar* out = result.ptr<uchar>(i);
+		for (int j = 0; j < q.cols; j++) out[j] = cv::saturate_cast<uchar>(row[j] * 255);
+	});
+	return result;
+}
+
+// enhances details of `image` against its self-guided filtered base layer
+cv::Mat guidedEnhance(const cv::Mat& image, int radius, double eps, double amount, int subsample) {
+	cv::Mat base = guidedPlane(image, image, radius, eps, subsample);
+	cv::Mat result(image.rows, image.cols, CV_8UC1);
+	forEachRow(image.rows, [&](int i) {
+		const float* row = base.ptr<float>(i);
+		const uchar* original = image.ptr<uchar>(i);
+		uchar* out = result.ptr<uchar>(i);
+		for (int j = 0; j < image.cols; j++) {
+			float q = row[j] * 255;
+			out[j] = cv::saturate_cast<uchar>(q + amount * (original[j] - q));
+		}
+	});
+	return result;
+}
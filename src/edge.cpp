@@ -0,0 +1,224 @@
+// Edge detection implementation
+
+#include "edge.h"
+#include "parallel.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define EDGE_SSE2
+#endif
+
+// image rows classified at once; every band keeps its smoothed rows, gradients and
+// magnitudes in buffers of a few rows more than the band, so that they stay in cache
+static const int ROW_BAND = 32;
+
+// classes of pixels after non-maximum suppression
+static const uchar NOT_EDGE = 0;
+static const uchar WEAK_EDGE = 1;
+static const uchar STRONG_EDGE = 2;
+
+// tan(22.5 degrees), splitting gradient directions into horizontal, vertical and diagonal
+static const float TAN_22_5 = 0.41421356f;
+
+// buffers of classifyBand, one set per pool thread, reused by the bands it runs
+struct BandScratch {
+	std::vector<float> line, smoothed, gx, gy, magnitude;
+};
+
+// normalized taps of a Gaussian of standard deviation `sigma`, over 3 sigma on each side
+static std::vector<float> gaussianTaps(double sigma) {
+	if (sigma <= 0) return { 1.0f };
+	int radius = static_cast<int>(std::ceil(3 * sigma));
+	std::vector<double> taps(2 * radius + 1);
+	double total = 0;
+	for (int k = -radius; k <= radius; k++) total += taps[k + radius] = std::exp(-k * k / (2 * sigma * sigma));
+	std::vector<float> result(taps.size());
+	for (size_t k = 0; k < taps.size(); k++) result[k] = static_cast<float>(taps[k] / total);
+	return result;
+}
+
+// dst[j] += tap * src[j] for j in [0, count)
+static void accumulate(float* dst, const uchar* src, float tap, int count) {
+	int j = 0;
+#ifdef EDGE_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 factor = _mm_set1_ps(tap);
+	for (; j + 16 <= count; j += 16) {
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + j));
+		__m128i words[2] = { _mm_unpacklo_epi8(bytes, zero), _mm_unpackhi_epi8(bytes, zero) };
+		for (int w = 0; w < 2; w++) {
+			__m128 low = _mm_cvtepi32_ps(_mm_unpacklo_epi16(words[w], zero));
+			__m128 high = _mm_cvtepi32_ps(_mm_unpackhi_epi16(words[w], zero));
+			float* out = dst + j + 8 * w;
+			_mm_storeu_ps(out, _mm_add_ps(_mm_loadu_ps(out), _mm_mul_ps(factor, low)));
+			_mm_storeu_ps(out + 4, _mm_add_ps(_mm_loadu_ps(out + 4), _mm_mul_ps(factor, high)));
+		}
+	}
+#endif
+	for (; j < count; j++) dst[j] += tap * src[j];
+}
+
+static void accumulate(float* dst, const float* src, float tap, int count) {
+	int j = 0;
+#ifdef EDGE_SSE2
+	const __m128 factor = _mm_set1_ps(tap);
+	for (; j + 4 <= count; j += 4) {
+		_mm_storeu_ps(dst + j, _mm_add_ps(_mm_loadu_ps(dst + j), _mm_mul_ps(factor, _mm_loadu_ps(src + j))));
+	}
+#endif
+	for (; j < count; j++) dst[j] += tap * src[j];
+}
+
+/**
+* classifies the pixels of rows [rowBegin, rowEnd) into `classes`, in one pass over the band
+* smoothing: separable Gaussian of the rows the band needs (two above and below), borders replicated
+* gradient: SOBEL_H_3 and SOBEL_V_3 on the smoothed rows, as signed floats
+* suppression: a pixel stays if its magnitude is not below its two neighbours along the
+*              gradient direction (strictly above the one before), and is then classified
+*              against the thresholds
+*/
+static void classifyBand(const cv::Mat& image, cv::Mat& classes, int rowBegin, int rowEnd,
+                         const std::vector<float>& taps, float low, float high, BandScratch& scratch) {
+	int rows = image.rows, cols = image.cols;
+	int radius = static_cast<int>(taps.size()) / 2;
+
+	// smoothed rows [first, last), the band and two rows of halo clipped to the image, with one
+	// replicated column on each side; every pass runs along contiguous rows
+	int first = std::max(rowBegin - 2, 0), last = std::min(rowEnd + 2, rows);
+	int stride = cols + 2;
+	std::vector<float>& line = scratch.line;
+	std::vector<float>& smoothed = scratch.smoothed;
+	line.resize(cols + 2 * radius);
+	smoothed.resize(static_cast<size_t>(last - first) * stride);
+	for (int i = first; i < last; i++) {
+		float* column = &line[radius];
+		std::fill(column, column + cols, 0.0f);
+		for (int k = -radius; k <= radius; k++) {
+			accumulate(column, image.ptr<uchar>(std::min(std::max(i + k, 0), rows - 1)), taps[k + radius], cols);
+		}
+		std::fill(line.begin(), line.begin() + radius, column[0]);
+		std::fill(line.end() - radius, line.end(), column[cols - 1]);
+		float* out = &smoothed[static_cast<size_t>(i - first) * stride + 1];
+		std::fill(out, out + cols, 0.0f);
+		for (int k = 0; k <= 2 * radius; k++) accumulate(out, &line[k], taps[k], cols);
+		out[-1] = out[0];
+		out[cols] = out[cols - 1];
+	}
+	auto smoothedRow = [&](int i) {
+		return &smoothed[static_cast<size_t>(std::min(std::max(i, 0), rows - 1) - first) * stride + 1];
+	};
+
+	// gradients of the band and one row of halo; magnitudes have a zero column on each side
+	// and zero rows outside the image
+	int gradFirst = std::max(rowBegin - 1, 0), gradLast = std::min(rowEnd + 1, rows);
+	std::vector<float>& gx = scratch.gx;
+	std::vector<float>& gy = scratch.gy;
+	std::vector<float>& magnitude = scratch.magnitude;
+	gx.resize(static_cast<size_t>(gradLast - gradFirst) * cols);
+	gy.resize(gx.size());
+	magnitude.assign(static_cast<size_t>(rowEnd - rowBegin + 2) * stride, 0.0f);
+	const float h0 = static_cast<float>(SOBEL_H_3[0]), h3 = static_cast<float>(SOBEL_H_3[3]);
+	const float v0 = static_cast<float>(SOBEL_V_3[0]), v1 = static_cast<float>(SOBEL_V_3[1]);
+	for (int i = gradFirst; i < gradLast; i++) {
+		const float* above = smoothedRow(i - 1);
+		const float* centre = smoothedRow(i);
+		const float* below = smoothedRow(i + 1);
+		float* outX = &gx[static_cast<size_t>(i - gradFirst) * cols];
+		float* outY = &gy[static_cast<size_t>(i - gradFirst) * cols];
+		float* outMagnitude = &magnitude[static_cast<size_t>(i - rowBegin + 1) * stride + 1];
+		int j = 0;
+#ifdef EDGE_SSE2
+		const __m128 h0s = _mm_set1_ps(h0), h3s = _mm_set1_ps(h3), v0s = _mm_set1_ps(v0), v1s = _mm_set1_ps(v1);
+		auto load = [](const float* p) { return _mm_loadu_ps(p); };
+		for (; j + 4 <= cols; j += 4) {
+			__m128 x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(h0s, _mm_sub_ps(load(above + j + 1), load(above + j - 1))),
+			                                 _mm_mul_ps(h3s, _mm_sub_ps(load(centre + j + 1), load(centre + j - 1)))),
+			                      _mm_mul_ps(h0s, _mm_sub_ps(load(below + j + 1), load(below + j - 1))));
+			__m128 y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(v0s, _mm_sub_ps(load(below + j - 1), load(above + j - 1))),
+			                                 _mm_mul_ps(v1s, _mm_sub_ps(load(below + j), load(above + j)))),
+			                      _mm_mul_ps(v0s, _mm_sub_ps(load(below + j + 1), load(above + j + 1))));
+			_mm_storeu_ps(outX + j, x);
+			_mm_storeu_ps(outY + j, y);
+			_mm_storeu_ps(outMagnitude + j, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y))));
+		}
+#endif
+		for (; j < cols; j++) {
+			// SOBEL_H_3 is antisymmetric in x and SOBEL_V_3 in y, with rows (h0, h3, h0) and columns (v0, v1, v0)
+			float x = h0 * (above[j + 1] - above[j - 1]) + h3 * (centre[j + 1] - centre[j - 1]) + h0 * (below[j + 1] - below[j - 1]);
+			float y = v0 * (below[j - 1] - above[j - 1]) + v1 * (below[j] - above[j]) + v0 * (below[j + 1] - above[j + 1]);
+			outX[j] = x;
+			outY[j] = y;
+			outMagnitude[j] = std::sqrt(x * x + y * y);
+		}
+	}
+
+	for (int i = rowBegin; i < rowEnd; i++) {
+		const float* x = &gx[static_cast<size_t>(i - gradFirst) * cols];
+		const float* y = &gy[static_cast<size_t>(i - gradFirst) * cols];
+		const float* centre = &magnitude[static_cast<size_t>(i - rowBegin + 1) * stride + 1];
+		uchar* out = classes.ptr<uchar>(i);
+		for (int j = 0; j < cols; j++) {
+			float m = centre[j];
+			if (m <= low) {
+				out[j] = NOT_EDGE;
+				continue;
+			}
+			float ax = std::abs(x[j]), ay = std::abs(y[j]);
+			// offset, in the magnitude buffer, of the neighbour along the gradient
+			int step;
+			if (ay <= TAN_22_5 * ax) step = 1;
+			else if (ax <= TAN_22_5 * ay) step = stride;
+			else step = ((x[j] < 0) == (y[j] < 0)) ? stride + 1 : stride - 1;
+			bool maximum = m > centre[j - step] && m >= centre[j + step];
+			out[j] = !maximum ? NOT_EDGE : (m > high) ? STRONG_EDGE : WEAK_EDGE;
+		}
+	}
+}
+
+/**
+* performs Canny edge detection of `image`
+* bands of rows are classified in parallel, then hysteresis links the weak edges to the
+* strong ones with an explicit stack, visiting every pixel at most once
+*/
+cv::Mat canny(const cv::Mat& image, double lowThreshold, double highThreshold, double sigma) {
+	if (image.type() != CV_8UC1) throw std::runtime_error("canny takes CV_8UC1 images!");
+	int rows = image.rows, cols = image.cols;
+	cv::Mat classes(rows, cols, CV_8UC1);
+	cv::Mat result(rows, cols, CV_8UC1, cv::Scalar(0));
+	if (rows == 0 || cols == 0) return result;
+
+	std::vector<float> taps = gaussianTaps(sigma);
+	float low = static_cast<float>(std::min(lowThreshold, highThreshold));
+	float high = static_cast<float>(highThreshold);
+	std::vector<BandScratch> scratch(getNumThreads());
+	parallelFor(0, rows, [&](int rowBegin, int rowEnd) {
+		for (int band = rowBegin; band < rowEnd; band += ROW_BAND) {
+			classifyBand(image, classes, band, std::min(band + ROW_BAND, rowEnd), taps, low, high, scratch[getThreadIndex()]);
+		}
+	}, ROW_BAND);
+
+	std::vector<std::pair<int, int>> stack;
+	auto mark = [&](int i, int j) {
+		result.ptr<uchar>(i)[j] = 255;
+		classes.ptr<uchar>(i)[j] = NOT_EDGE;
+		stack.emplace_back(i, j);
+	};
+	for (int i = 0; i < rows; i++) {
+		for (int j = 0; j < cols; j++) {
+			if (classes.ptr<uchar>(i)[j] == STRONG_EDGE) mark(i, j);
+		}
+	}
+	while (!stack.empty()) {
+		auto pixel = stack.back();
+		stack.pop_back();
+		for (int di = -1; di <= 1; di++) {
+			for (int dj = -1; dj <= 1; dj++) {
+				int i = pixel.first + di, j = pixel.second + dj;
+				if (i >= 0 && i < rows && j >= 0 && j < cols && classes.ptr<uchar>(i)[j] != NOT_EDGE) mark(i, j);
+			}
+		}
+	}
+	return result;
+}
@@ -0,0 +1,99 @@
+// AVX2 lanes of the radix-2 and radix-4 FFT passes
+// this source is compiled for AVX2 whatever the flags of the others, and its kernels only run
+// in plans built on a CPU that supports it (see fftIsaSupported)
+
+#include "freqfilt.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+#include "fftlanes.h"
+
+namespace {
+
+template <class R>
+struct Avx2Complex;
+
+// 2 complex numbers at a time
+template <>
+struct Avx2Complex<double> {
+    using Real = double;
+    using Complex = cd;
+    using T = __m256d;
+    static const int WIDTH = 2;
+    static T load(const cd* p) { return _mm256_loadu_pd(reinterpret_cast<const double*>(p)); }
+    static void store(cd* p, T v) { _mm256_storeu_pd(reinterpret_cast<double*>(p), v); }
+    static T add(T a, T b) { return _mm256_add_pd(a, b); }
+    static T sub(T a, T b) { return _mm256_sub_pd(a, b); }
+    static T mul(T v, const double* re, const double* im) {
+        T swapped = _mm256_permute_pd(v, 0x5);
+        return _mm256_addsub_pd(_mm256_mul_pd(v, _mm256_loadu_pd(re)), _mm256_mul_pd(swapped, _mm256_loadu_pd(im)));
+    }
+    template <bool Invert> static T rotate(T v) {
+        T swapped = _mm256_permute_pd(v, 0x5);
+        return _mm256_xor_pd(swapped, Invert ? _mm256_set_pd(-0.0, 0.0, -0.0, 0.0) : _mm256_set_pd(0.0, -0.0, 0.0, -0.0));
+    }
+};
+
+// 4 complex numbers at a time
+template <>
+struct Avx2Complex<float> {
+    using Real = float;
+    using Complex = cf;
+    using T = __m256;
+    static const int WIDTH = 4;
+    static T load(const cf* p) { return _mm256_loadu_ps(reinterpret_cast<const float*>(p)); }
+    static void store(cf* p, T v) { _mm256_storeu_ps(reinterpret_cast<float*>(p), v); }
+    static T add(T a, T b) { return _mm256_add_ps(a, b); }
+    static T sub(T a, T b) { return _mm256_sub_ps(a, b); }
+    static T mul(T v, const float* re, const float* im) {
+        T swapped = _mm256_permute_ps(v, 0xB1);
+        return _mm256_addsub_ps(_mm256_mul_ps(v, _mm256_loadu_ps(re)), _mm256_mul_ps(swapped, _mm256_loadu_ps(im)));
+    }
+    template <bool Invert> static T rotate(T v) {
+        T swapped = _mm256_permute_ps(v, 0xB1);
+        const float n = -0.0f, p = 0.0f;
+        return _mm256_xor_ps(swapped, Invert ? _mm256_set_ps(n, p, n, p, n, p, n, p) : _mm256_set_ps(p, n, p, n, p, n, p, n));
+    }
+};
+
+} // namespace
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+template <>
+const FftKernels<double>* avx2Kernels<double>() {
+    static const FftKernels<double> kernels = FFT_KERNELS(Avx2Complex<double>);
+    return &kernels;
+}
+
+template <>
+const FftKernels<float>* avx2Kernels<float>() {
+    static const FftKernels<float> kernels = FFT_KERNELS(Avx2Complex<float>);
+    return &kernels;
+}
+
+#else
+#include "fftlanes.h"
+
+template <>
+const FftKernels<double>* avx2Kernels<double>() {
+    return nullptr;
+}
+
+template <>
+const FftKernels<float>* avx2Kernels<float>() {
+    return nullptr;
+}
+#endif
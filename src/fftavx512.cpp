@@ -0,0 +1,100 @@
+// AVX-512 lanes of the radix-2 and radix-4 FFT passes
+// this source is compiled for AVX-512 whatever the flags of the others, and its kernels only run
+// in plans built on a CPU that supports it (see fftIsaSupported)
+
+#include "freqfilt.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#endif
+
+#include "fftlanes.h"
+
+namespace {
+
+template <class R>
+struct Avx512Complex;
+
+// 4 complex numbers at a time; the complex product is one multiply and one fused multiply
+// with alternating subtract and add
+template <>
+struct Avx512Complex<double> {
+    using Real = double;
+    using Complex = cd;
+    using T = __m512d;
+    static const int WIDTH = 4;
+    static T load(const cd* p) { return _mm512_loadu_pd(reinterpret_cast<const double*>(p)); }
+    static void store(cd* p, T v) { _mm512_storeu_pd(reinterpret_cast<double*>(p), v); }
+    static T add(T a, T b) { return _mm512_add_pd(a, b); }
+    static T sub(T a, T b) { return _mm512_sub_pd(a, b); }
+    static T mul(T v, const double* re, const double* im) {
+        T swapped = _mm512_shuffle_pd(v, v, 0x55);
+        return _mm512_fmaddsub_pd(v, _mm512_loadu_pd(re), _mm512_mul_pd(swapped, _mm512_loadu_pd(im)));
+    }
+    // swaps the parts, then negates the real ones (forward) or the imaginary ones (inverse)
+    template <bool Invert> static T rotate(T v) {
+        T swapped = _mm512_shuffle_pd(v, v, 0x55);
+        return _mm512_mask_sub_pd(swapped, Invert ? 0xAA : 0x55, _mm512_setzero_pd(), swapped);
+    }
+};
+
+// 8 complex numbers at a time
+template <>
+struct Avx512Complex<float> {
+    using Real = float;
+    using Complex = cf;
+    using T = __m512;
+    static const int WIDTH = 8;
+    static T load(const cf* p) { return _mm512_loadu_ps(reinterpret_cast<const float*>(p)); }
+    static void store(cf* p, T v) { _mm512_storeu_ps(reinterpret_cast<float*>(p), v); }
+    static T add(T a, T b) { return _mm512_add_ps(a, b); }
+    static T sub(T a, T b) { return _mm512_sub_ps(a, b); }
+    static T mul(T v, const float* re, const float* im) {
+        T swapped = _mm512_shuffle_ps(v, v, 0xB1);
+        return _mm512_fmaddsub_ps(v, _mm512_loadu_ps(re), _mm512_mul_ps(swapped, _mm512_loadu_ps(im)));
+    }
+    template <bool Invert> static T rotate(T v) {
+        T swapped = _mm512_shuffle_ps(v, v, 0xB1);
+        return _mm512_mask_sub_ps(swapped, Invert ? 0xAAAA : 0x5555, _mm512_setzero_ps(), swapped);
+    }
+};
+
+} // namespace
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+template <>
+const FftKernels<double>* avx512Kernels<double>() {
+    static const FftKernels<double> kernels = FFT_KERNELS(Avx512Complex<double>);
+    return &kernels;
+}
+
+template <>
+const FftKernels<float>* avx512Kernels<float>() {
+    static const FftKernels<float> kernels = FFT_KERNELS(Avx512Complex<float>);
+    return &kernels;
+}
+
+#else
+#include "fftlanes.h"
+
+template <>
+const FftKernels<double>* avx512Kernels<double>() {
+    return nullptr;
+}
+
+template <>
+const FftKernels<float>* avx512Kernels<float>() {
+    return nullptr;
+}
+#endif
@@ -0,0 +1,129 @@
+// Lane kernels of the radix-2 and radix-4 FFT passes, private to the FFT sources
+// every source compiled for one instruction set includes this file after its standard headers
+// and after switching its target, and exports the table of its kernels; the functions here
+// are in an unnamed namespace, so that the copies compiled for different instruction sets are
+// never merged by the linker
+
+#ifndef FFTLANES_H
+#define FFTLANES_H
+
+#include <complex>
+
+// kernels of one instruction set and precision R, indexed by direction (1 for IFFT)
+template <class R>
+struct FftKernels {
+    using Complex = std::complex<R>;
+    int width; // complex numbers per lane
+    void (*radix4Pass[2])(Complex*, int, int, const R*, const R*, const R*, const R*);
+    void (*radix2Butterflies[2])(Complex*, int, const R*, const R*);
+    void (*radix4Butterflies[2])(Complex*, int, const R*, const R*);
+};
+
+// tables of the sources compiled for AVX2 and AVX-512, or nullptr where they are not built
+template <class R> const FftKernels<R>* avx2Kernels();
+template <class R> const FftKernels<R>* avx512Kernels();
+
+namespace {
+
+// product of complex numbers, without the checks for infinite operands of std::complex
+template <class T>
+inline std::complex<T> mul(const std::complex<T>& a, const std::complex<T>& b) {
+    return std::complex<T>(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+}
+
+// i times the direction of the transform
+template <bool Invert, class T>
+inline std::complex<T> rotate(const std::complex<T>& a) {
+    return Invert ? std::complex<T>(a.imag(), -a.real()) : std::complex<T>(-a.imag(), a.real());
+}
+
+// lane operations over consecutive interleaved complex numbers for the radix-2 and radix-4
+// butterflies; twiddles are read from a table of real parts and one of imaginary parts, each
+// value stored twice so that it loads into both halves of a complex lane
+template <class R>
+struct ScalarComplex {
+    using Real = R;
+    using Complex = std::complex<R>;
+    using T = Complex;
+    static const int WIDTH = 1;
+    static T load(const Complex* p) { return *p; }
+    static void store(Complex* p, T v) { *p = v; }
+    static T add(T a, T b) { return a + b; }
+    static T sub(T a, T b) { return a - b; }
+    static T mul(T v, const R* re, const R* im) { return ::mul(v, Complex(re[0], im[0])); }
+    template <bool Invert> static T rotate(T v) { return ::rotate<Invert>(v); }
+};
+
+/**
+* butterflies of indices [begin, end) merging `Radix` (2 or 4) blocks of `m` elements of `out`,
+* V::WIDTH of them at a time; the input q of butterfly k is twiddled by entry (q - 1) m + k of
+* the tables `re` and `im`
+*/
+template <bool Invert, int Radix, class V>
+void laneButterflies(typename V::Complex* out, int m, const typename V::Real* re, const typename V::Real* im, int begin, int end) {
+    using T = typename V::T;
+    for (int k = begin; k < end; k += V::WIDTH) {
+        T a[Radix];
+        a[0] = V::load(out + k);
+        for (int q = 1; q < Radix; q++) {
+            int index = 2 * ((q - 1) * m + k);
+            a[q] = V::mul(V::load(out + k + q * m), re + index, im + index);
+        }
+        if (Radix == 2) {
+            V::store(out + k, V::add(a[0], a[1]));
+            V::store(out + k + m, V::sub(a[0], a[1]));
+        }
+        else {
+            T even = V::add(a[0], a[2]), evenDifference = V::sub(a[0], a[2]);
+            T odd = V::add(a[1], a[3]), oddDifference = V::template rotate<Invert>(V::sub(a[1], a[3]));
+            V::store(out + k, V::add(even, odd));
+            V::store(out + k + m, V::add(evenDifference, oddDifference));
+            V::store(out + k + 2 * m, V::sub(even, odd));
+            V::store(out + k + 3 * m, V::sub(evenDifference, oddDifference));
+        }
+    }
+}
+
+// butterflies of the mixed-radix transform for radix 2 and 4: the lanes of V, then scalars
+// for the elements left over
+template <bool Invert, int Radix, class V>
+void wideButterflies(typename V::Complex* out, int m, const typename V::Real* re, const typename V::Real* im) {
+    int wide = m / V::WIDTH * V::WIDTH;
+    laneButterflies<Invert, Radix, V>(out, m, re, im, 0, wide);
+    laneButterflies<Invert, Radix, ScalarComplex<typename V::Real>>(out, m, re, im, wide, m);
+}
+
+/**
+* two passes of the radix-2 transform in one, over groups of 4 `half` elements: the pass
+* merging blocks of `half` elements (twiddles of table `re1`/`im1`), then the one merging
+* blocks of 2 `half` (table `re2`/`im2`, whose entries past `half` are those below times +-i)
+*/
+template <bool Invert, class V>
+void radix4Pass(typename V::Complex* seq, int n, int half, const typename V::Real* re1, const typename V::Real* im1,
+                       const typename V::Real* re2, const typename V::Real* im2) {
+    using T = typename V::T;
+    for (int i = 0; i < n; i += 4 * half) {
+        for (int j = 0; j < half; j += V::WIDTH) {
+            typename V::Complex* x = seq + i + j;
+            T a0 = V::load(x), a1 = V::mul(V::load(x + half), re1 + 2 * j, im1 + 2 * j);
+            T a2 = V::load(x + 2 * half), a3 = V::mul(V::load(x + 3 * half), re1 + 2 * j, im1 + 2 * j);
+            T b0 = V::add(a0, a1), b1 = V::sub(a0, a1);
+            T b2 = V::mul(V::add(a2, a3), re2 + 2 * j, im2 + 2 * j);
+            T b3 = V::template rotate<Invert>(V::mul(V::sub(a2, a3), re2 + 2 * j, im2 + 2 * j));
+            V::store(x, V::add(b0, b2));
+            V::store(x + 2 * half, V::sub(b0, b2));
+            V::store(x + half, V::add(b1, b3));
+            V::store(x + 3 * half, V::sub(b1, b3));
+        }
+    }
+}
+
+} // namespace
+
+// kernel table of the lanes V, as a constant initializer that runs none of their code
+#define FFT_KERNELS(V)                                                                  \
+    { V::WIDTH, { radix4Pass<false, V>, radix4Pass<true, V> },                          \
+      { wideButterflies<false, 2, V>, wideButterflies<true, 2, V> },                    \
+      { wideButterflies<false, 4, V>, wideButterflies<true, 4, V> } }
+
+#endif // FFTLANES_H
@@ -1,10 +1,18 @@
 #include "filt.h"
+#include "freqfilt.h"
+#include "parallel.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
 
 // filter declaration
 
 // high pass
 
-std::vector<double> HIGH_PASS = {
+constexpr Coeffs<3> HIGH_PASS = {
 	-1, -1, -1,
 	-1,  8, -1,
 	-1, -1, -1
@@ -14,13 +22,13 @@ std::vector<double> HIGH_PASS = {
 
 // mean
 
-std::vector<double> MEAN_3 = {
+constexpr Coeffs<3> MEAN_3 = {
 	0.11111111, 0.11111111, 0.11111111,
 	0.11111111, 0.11111111, 0.11111111,
 	0.11111111, 0.11111111, 0.11111111
 };
 
-std::vector<double> MEAN_5 = {
+constexpr Coeffs<5> MEAN_5 = {
 	0.04000000, 0.04000000, 0.04000000, 0.04000000, 0.04000000,
 	0.04000000, 0.04000000, 0.04000000, 0.04000000, 0.04000000,
 	0.04000000, 0.04000000, 0.04000000, 0.04000000, 0.04000000,
@@ -28,7 +36,7 @@ std::vector<double> MEAN_5 = {
 	0.04000000, 0.04000000, 0.04000000, 0.04000000, 0.04000000
 };
 
-std::vector<double> MEAN_7 = {
+constexpr Coeffs<7> MEAN_7 = {
 	0.02040816, 0.02040816, 0.02040816, 0.02040816, 0.02040816, 0.02040816, 0.02040816,
 	0.02040816, 0.02040816, 0.02040816, 0.02040816, 0.02040816, 0.02040816, 0.02040816,
 	0.02040816, 0.02040816, 0.02040816, 0.02040816, 0.02040816, 0.02040816, 0.02040816,
@@ -38,7 +46,7 @@ std::vector<double> MEAN_7 = {
 	0.02040816, 0.02040816, 0.02040816, 0.02040816, 0.02040816, 0.02040816, 0.02040816
 };
 
-std::vector<double> MEAN_9 = {
+constexpr Coeffs<9> MEAN_9 = {
 	0.01234568, 0.01234568, 0.01234568, 0.01234568, 0.01234568, 0.01234568, 0.01234568, 0.01234568, 0.01234568,
 	0.01234568, 0.01234568, 0.01234568, 0.01234568, 0.01234568, 0.01234568, 0.01234568, 0.01234568, 0.01234568,
 	0.01234568, 0.01234568, 0.01234568, 0.01234568, 0.01234568, 0.01234568, 0.01234568, 0.01234568, 0.01234568,
@@ -54,19 +62,19 @@ std::vector<double> MEAN_9 = {
 
 // prewitt
 
-std::vector<double> PREWITT_H_3 = {
+constexpr Coeffs<3> PREWITT_H_3 = {
 	-1, 0, 1,
 	-1, 0, 1,
 	-1, 0, 1
 };
 
-std::vector<double> PREWITT_V_3 = {
+constexpr Coeffs<3> PREWITT_V_3 = {
 	-1, -1, -1,
 	0, 0, 0,
 	1, 1, 1
 };
 
-std::vector<double> PREWITT_H_5 = {
+constexpr Coeffs<5> PREWITT_H_5 = {
 	-2, -1, 0, 1, 2,
 	-2, -1, 0, 1, 2,
 	-2, -1, 0, 1, 2,
@@ -74,7 +82,7 @@ std::vector<double> PREWITT_H_5 = {
 	-2, -1, 0, 1, 2
 };
 
-std::vector<double> PREWITT_V_5 = {
+constexpr Coeffs<5> PREWITT_V_5 = {
 	-2, -2, -2, -2, -2,
 	-1, -1, -1, -1, -1,
 	0, 0, 0, 0, 0,
@@ -82,7 +90,7 @@ std::vector<double> PREWITT_V_5 = {
 	2, 2, 2, 2, 2
 };
 
-std::vector<double> PREWITT_H_7 = {
+constexpr Coeffs<7> PREWITT_H_7 = {
 	-3, -2, -1, 0, 1, 2, 3,
 	-3, -2, -1, 0, 1, 2, 3,
 	-3, -2, -1, 0, 1, 2, 3,
@@ -92,7 +100,7 @@ std::vector<double> PREWITT_H_7 = {
 	-3, -2, -1, 0, 1, 2, 3
 };
 
-std::vector<double> PREWITT_V_7 = {
+constexpr Coeffs<7> PREWITT_V_7 = {
 	-3, -3, -3, -3, -3, -3, -3,
 	-2, -2, -2, -2, -2, -2, -2,
 	-1, -1, -1, -1, -1, -1, -1,
@@ -102,7 +110,7 @@ std::vector<double> PREWITT_V_7 = {
 	3, 3, 3, 3, 3, 3, 3
 };
 
-std::vector<double> PREWITT_H_9 = {
+constexpr Coeffs<9> PREWITT_H_9 = {
 	-4, -3, -2, -1, 0, 1, 2, 3, 4,
 	-4, -3, -2, -1, 0, 1, 2, 3, 4,
 	-4, -3, -2, -1, 0, 1, 2, 3, 4,
@@ -114,7 +122,7 @@ std::vector<double> PREWITT_H_9 = {
 	-4, -3, -2, -1, 0, 1, 2, 3, 4
 };
 
-std::vector<double> PREWITT_V_9 = {
+constexpr Coeffs<9> PREWITT_V_9 = {
 	-4, -4, -4, -4, -4, -4, -4, -4, -4,
 	-3, -3, -3, -3, -3, -3, -3, -3, -3,
 	-2, -2, -2, -2, -2, -2, -2, -2, -2,
@@ -130,25 +138,25 @@ std::vector<double> PREWITT_V_9 = {
 
 // sobel
 
-std::vector<double> SOBEL_H_3 = {
+constexpr Coeffs<3> SOBEL_H_3 = {
 	-0.50000000, 0.00000000, 0.50000000,
 	-1.00000000, 0.00000000, 1.00000000,
 	-0.50000000, 0.00000000, 0.50000000
 };
 
-std::vector<double> SOBEL_V_3 = {
+constexpr Coeffs<3> SOBEL_V_3 = {
 	-0.50000000, -1.00000000, -0.50000000,
 	0.00000000, 0.00000000, 0.00000000,
 	0.50000000, 1.00000000, 0.50000000
 };
 
-std::vector<double> SOBEL_D_3 = {
+constexpr Coeffs<3> SOBEL_D_3 = {
 	0.00000, -0.70711, -0.70711,
 	0.70711, 0.00000, -0.70711,
 	0.70711, 0.70711, 0.00000
 };
 
-std::vector<double> SOBEL_H_5 = {
+constexpr Coeffs<5> SOBEL_H_5 = {
 	-0.25000000, -0.20000000, 0.00000000, 0.20000000, 0.25000000,
 	-0.40000000, -0.50000000, 0.00000000, 0.50000000, 0.40000000,
 	-0.50000000, -1.00000000, 0.00000000, 1.00000000, 0.50000000,
@@ -156,7 +164,7 @@ std::vector<double> SOBEL_H_5 = {
 	-0.25000000, -0.20000000, 0.00000000, 0.20000000, 0.25000000
 };
 
-std::vector<double> SOBEL_V_5 = {
+constexpr Coeffs<5> SOBEL_V_5 = {
 	-0.25000000, -0.40000000, -0.50000000, -0.40000000, -0.25000000,
 	-0.20000000, -0.50000000, -1.00000000, -0.50000000, -0.20000000,
 	0.00000000, 0.00000000, 0.00000000, 0.00000000, 0.00000000,
@@ -164,7 +172,7 @@ std::vector<double> SOBEL_V_5 = {
 	0.25000000, 0.40000000, 0.50000000, 0.40000000, 0.25000000
 };
 
-std::vector<double> SOBEL_D_5 = {
+constexpr Coeffs<5> SOBEL_D_5 = {
 	0.00000, -0.14142, -0.35355, -0.42426, -0.35355,
 	0.14142, 0.00000, -0.70711, -0.70711, -0.42426,
 	0.35355, 0.70711, 0.00000, -0.70711, -0.35355,
@@ -172,7 +180,7 @@ std::vector<double> SOBEL_D_5 = {
 	0.35355, 0.42426, 0.35355, 0.14142, 0.00000
 };
 
-std::vector<double> SOBEL_H_7 = {
+constexpr Coeffs<7> SOBEL_H_7 = {
 	-0.16666667, -0.15384615, -0.10000000, 0.00000000, 0.10000000, 0.15384615, 0.16666667,
 	-0.23076923, -0.25000000, -0.20000000, 0.00000000, 0.20000000, 0.25000000, 0.23076923,
 	-0.30000000, -0.40000000, -0.50000000, 0.00000000, 0.50000000, 0.40000000, 0.30000000,
@@ -182,7 +190,7 @@ std::vector<double> SOBEL_H_7 = {
 	-0.16666667, -0.15384615, -0.10000000, 0.00000000, 0.10000000, 0.15384615, 0.16666667
 };
 
-std::vector<double> SOBEL_V_7 = {
+constexpr Coeffs<7> SOBEL_V_7 = {
 	-0.16666667, -0.23076923, -0.30000000, -0.33333333, -0.30000000, -0.23076923, -0.16666667,
 	-0.15384615, -0.25000000, -0.40000000, -0.50000000, -0.40000000, -0.25000000, -0.15384615,
 	-0.10000000, -0.20000000, -0.50000000, -1.00000000, -0.50000000, -0.20000000, -0.10000000,
@@ -192,7 +200,7 @@ std::vector<double> SOBEL_V_7 = {
 	0.16666667, 0.23076923, 0.30000000, 0.33333333, 0.30000000, 0.23076923, 0.16666667
 };
 
-std::vector<double> SOBEL_D_7 = {
+constexpr Coeffs<7> SOBEL_D_7 = {
 	0.00000, -0.05439, -0.14142, -0.23570, -0.28284, -0.27196, -0.23570,
 	0.05439, 0.00000, -0.14142, -0.35355, -0.42426, -0.35355, -0.27196,
 	0.14142, 0.14142, 0.00000, -0.70711, -0.70711, -0.42426, -0.28284,
@@ -202,7 +210,7 @@ std::vector<double> SOBEL_D_7 = {
 	0.23570, 0.27196, 0.28284, 0.23570, 0.14142, 0.05439, 0.00000
 };
 
-std::vector<double> SOBEL_H_9 = {
+constexpr Coeffs<9> SOBEL_H_9 = {
 	-0.12500000, -0.12000000, -0.10000000, -0.05882353, 0.00000000, 0.05882353, 0.10000000, 0.12000000, 0.12500000,
 	-0.16000000, -0.16666667, -0.15384615, -0.10000000, 0.00000000, 0.10000000, 0.15384615, 0.16666667, 0.16000000,
 	-0.20000000, -0.23076923, -0.25000000, -0.20000000, 0.00000000, 0.20000000, 0.25000000, 0.23076923, 0.20000000,
@@ -214,7 +222,7 @@ std::vector<double> SOBEL_H_9 = {
 	-0.12500000, -0.12000000, -0.10000000, -0.05882353, 0.00000000, 0.05882353, 0.10000000, 0.12000000, 0.12500000
 };
 
-std::vector<double> SOBEL_V_9 = {
+constexpr Coeffs<9> SOBEL_V_9 = {
 	-0.12500000, -0.16000000, -0.20000000, -0.23529412, -0.25000000, -0.23529412, -0.20000000, -0.16000000, -0.12500000,
 	-0.12000000, -0.16666667, -0.23076923, -0.30000000, -0.33333333, -0.30000000, -0.23076923, -0.16666667, -0.12000000,
 	-0.10000000, -0.15384615, -0.25000000, -0.40000000, -0.50000000, -0.40000000, -0.25000000, -0.15384615, -0.10000000,
@@ -226,7 +234,7 @@ std::vector<double> SOBEL_V_9 = {
 	0.12500000, 0.16000000, 0.20000000, 0.23529412, 0.25000000, 0.23529412, 0.20000000, 0.16000000, 0.12500000
 };
 
-std::vector<double> SOBEL_D_9 = {
+constexpr Coeffs<9> SOBEL_D_9 = {
 	0.00000, -0.02828, -0.07071, -0.12478, -0.17678, -0.20797, -0.21213, -0.19799, -0.17678,
 	0.02828, 0.00000, -0.05439, -0.14142, -0.23570, -0.28284, -0.27196, -0.23570, -0.19799,
 	0.07071, 0.05439, 0.00000, -0.14142, -0.35355, -0.42426, -0.35355, -0.27196, -0.21213,
@@ -242,13 +250,13 @@ std::vector<double> SOBEL_D_9 = {
 
 // laplacian
 
-std::vector<double> LAPLACIAN_3 = {
+constexpr Coeffs<3> LAPLACIAN_3 = {
 	-0.11111111, -0.11111111, -0.11111111,
 	-0.11111111, 0.88888889, -0.11111111,
 	-0.11111111, -0.11111111, -0.11111111
 };
 
-std::vector<double> LAPLACIAN_5 = {
+constexpr Coeffs<5> LAPLACIAN_5 = {
 	-0.04000000, -0.04000000, -0.04000000, -0.04000000, -0.04000000,
 	-0.04000000, -0.04000000, -0.04000000, -0.04000000, -0.04000000,
 	-0.04000000, -0.04000000, 0.96000000, -0.04000000, -0.04000000,
@@ -256,7 +264,7 @@ std::vector<double> LAPLACIAN_5 = {
 	-0.04000000, -0.04000000, -0.04000000, -0.04000000, -0.04000000
 };
 
-std::vector<double> LAPLACIAN_7 = {
+constexpr Coeffs<7> LAPLACIAN_7 = {
 	-0.02040816, -0.02040816, -0.02040816, -0.02040816, -0.02040816, -0.02040816, -0.02040816,
 	-0.02040816, -0.02040816, -0.02040816, -0.02040816, -0.02040816, -0.02040816, -0.02040816,
 	-0.02040816, -0.02040816, -0.02040816, -0.02040816, -0.02040816, -0.02040816, -0.02040816,
@@ -266,7 +274,7 @@ std::vector<double> LAPLACIAN_7 = {
 	-0.02040816, -0.02040816, -0.02040816, -0.02040816, -0.02040816, -0.02040816, -0.02040816
 };
 
-std::vector<double> LAPLACIAN_9 = {
+constexpr Coeffs<9> LAPLACIAN_9 = {
 	-0.01234568, -0.01234568, -0.01234568, -0.01234568, -0.01234568, -0.01234568, -0.01234568, -0.01234568, -0.01234568,
 	-0.01234568, -0.01234568, -0.01234568, -0.01234568, -0.01234568, -0.01234568, -0.01234568, -0.01234568, -0.01234568,
 	-0.01234568, -0.01234568, -0.01234568, -0.01234568, -0.01234568, -0.01234568, -0.01234568, -0.01234568, -0.01234568,
@@ -282,13 +290,13 @@ std::vector<double> LAPLACIAN_9 = {
 
 // gaussian
 
-std::vector<double> GAUSSIAN_3 = {
+constexpr Coeffs<3> GAUSSIAN_3 = {
 	0.01166010, 0.08615712, 0.01166010,
 	0.08615712, 0.63661977, 0.08615712,
 	0.01166010, 0.08615712, 0.01166010
 };
 
-std::vector<double> GAUSSIAN_5 = {
+constexpr Coeffs<5> GAUSSIAN_5 = {
 	0.00072218, 0.00626214, 0.01286514, 0.00626214, 0.00072218,
 	0.00626214, 0.05429984, 0.11155540, 0.05429984, 0.00626214,
 	0.01286514, 0.11155540, 0.22918312, 0.11155540, 0.01286514,
@@ -296,7 +304,7 @@ std::vector<double> GAUSSIAN_5 = {
 	0.00072218, 0.00626214, 0.01286514, 0.00626214, 0.00072218
 };
 
-std::vector<double> GAUSSIAN_7 = {
+constexpr Coeffs<7> GAUSSIAN_7 = {
 	0.00015713, 0.00098616, 0.00296865, 0.00428643, 0.00296865, 0.00098616, 0.00015713,
 	0.00098616, 0.00618917, 0.01863129, 0.02690169, 0.01863129, 0.00618917, 0.00098616,
 	0.00296865, 0.01863129, 0.05608582, 0.08098224, 0.05608582, 0.01863129, 0.00296865,
@@ -306,7 +314,7 @@ std::vector<double> GAUSSIAN_7 = {
 	0.00015713, 0.00098616, 0.00296865, 0.00428643, 0.00296865, 0.00098616, 0.00015713
 };
 
-std::vector<double> GAUSSIAN_9 = {
+constexpr Coeffs<9> GAUSSIAN_9 = {
 	0.00005772, 0.00027346, 0.00083069, 0.00161797, 0.00202060, 0.00161797, 0.00083069, 0.00027346, 0.00005772,
 	0.00027346, 0.00129557, 0.00393558, 0.00766547, 0.00957301, 0.00766547, 0.00393558, 0.00129557, 0.00027346,
 	0.00083069, 0.00393558, 0.01195525, 0.02328564, 0.02908025, 0.02328564, 0.01195525, 0.00393558, 0.00083069,
@@ -322,13 +330,13 @@ std::vector<double> GAUSSIAN_9 = {
 
 // LAPLACIAN_OF_GAUSSIAN
 
-std::vector<double> LAPLACIAN_OF_GAUSSIAN_3 = {
+constexpr Coeffs<3> LAPLACIAN_OF_GAUSSIAN_3 = {
 	0.27984235, 0.68925694, 0.27984235,
 	0.68925694, -5.09295818, 0.68925694,
 	0.27984235, 0.68925694, 0.27984235
 };
 
-std::vector<double> LAPLACIAN_OF_GAUSSIAN_5 = {
+constexpr Coeffs<5> LAPLACIAN_OF_GAUSSIAN_5 = {
 	0.00990024, 0.04689087, 0.06965701, 0.04689087, 0.00990024,
 	0.04689087, 0.06880876, -0.08995827, 0.06880876, 0.04689087,
 	0.06965701, -0.08995827, -0.66004738, -0.08995827, 0.06965701,
@@ -336,7 +344,7 @@ std::vector<double> LAPLACIAN_OF_GAUSSIAN_5 = {
 	0.00990024, 0.04689087, 0.06965701, 0.04689087, 0.00990024
 };
 
-std::vector<double> LAPLACIAN_OF_GAUSSIAN_7 = {
+constexpr Coeffs<7> LAPLACIAN_OF_GAUSSIAN_7 = {
 	0.00129580, 0.00547093, 0.01166194, 0.01452495, 0.01166194, 0.00547093, 0.00129580,
 	0.00547093, 0.01763179, 0.02290694, 0.01855443, 0.02290694, 0.01763179, 0.00547093,
 	0.01166194, 0.02290694, -0.02186436, -0.07528212, -0.02186436, 0.02290694, 0.01166194,
@@ -346,7 +354,7 @@ std::vector<double> LAPLACIAN_OF_GAUSSIAN_7 = {
 	0.00129580, 0.00547093, 0.01166194, 0.01452495, 0.01166194, 0.00547093, 0.00129580
 };
 
-std::vector<double> LAPLACIAN_OF_GAUSSIAN_9 = {
+constexpr Coeffs<9> LAPLACIAN_OF_GAUSSIAN_9 = {
 	0.00031354, 0.00110734, 0.00254335, 0.00399498, 0.00459000, 0.00399498, 0.00254335, 0.00110734, 0.00031354,
 	0.00110734, 0.00345484, 0.00660789, 0.00832792, 0.00850934, 0.00832792, 0.00660789, 0.00345484, 0.00110734,
 	0.00254335, 0.00660789, 0.00826536, 0.00229982, -0.00287212, 0.00229982, 0.00826536, 0.00660789, 0.00254335,
@@ -363,103 +371,1091 @@ const char* FILTER_NAME[11] = {
 	"LAPLACIAN", "GAUSSIAN", "LAPLACIAN_OF_GAUSSIAN"
 };
 
-Vec2d MEAN = { MEAN_3, MEAN_5, MEAN_7, MEAN_9 };
-Vec2d PREWITT_H = { PREWITT_H_3, PREWITT_H_5, PREWITT_H_7, PREWITT_H_9 };
-Vec2d PREWITT_V = { PREWITT_V_3, PREWITT_V_5, PREWITT_V_7, PREWITT_V_9 };
-Vec2d SOBEL_H = { SOBEL_H_3, SOBEL_H_5, SOBEL_H_7, SOBEL_H_9 };
-Vec2d SOBEL_V = { SOBEL_V_3, SOBEL_V_5, SOBEL_V_7, SOBEL_V_9 };
-Vec2d SOBEL_D = { SOBEL_D_3, SOBEL_D_5, SOBEL_D_7, SOBEL_D_9 };
-Vec2d LAPLACIAN = { LAPLACIAN_3, LAPLACIAN_5, LAPLACIAN_7, LAPLACIAN_9 };
-Vec2d GAUSSIAN = { GAUSSIAN_3, GAUSSIAN_5, GAUSSIAN_7, GAUSSIAN_9 };
-Vec2d LAPLACIAN_OF_GAUSSIAN = { LAPLACIAN_OF_GAUSSIAN_3, LAPLACIAN_OF_GAUSSIAN_5, LAPLACIAN_OF_GAUSSIAN_7, LAPLACIAN_OF_GAUSSIAN_9 };
+const double* const FILTERS[11][4] = {
+	{ nullptr, nullptr, nullptr, nullptr },
+	{ MEAN_3.data(), MEAN_5.data(), MEAN_7.data(), MEAN_9.data() },
+	{ nullptr, nullptr, nullptr, nullptr },
+	{ PREWITT_H_3.data(), PREWITT_H_5.data(), PREWITT_H_7.data(), PREWITT_H_9.data() },
+	{ PREWITT_V_3.data(), PREWITT_V_5.data(), PREWITT_V_7.data(), PREWITT_V_9.data() },
+	{ SOBEL_H_3.data(), SOBEL_H_5.data(), SOBEL_H_7.data(), SOBEL_H_9.data() },
+	{ SOBEL_V_3.data(), SOBEL_V_5.data(), SOBEL_V_7.data(), SOBEL_V_9.data() },
+	{ SOBEL_D_3.data(), SOBEL_D_5.data(), SOBEL_D_7.data(), SOBEL_D_9.data() },
+	{ LAPLACIAN_3.data(), LAPLACIAN_5.data(), LAPLACIAN_7.data(), LAPLACIAN_9.data() },
+	{ GAUSSIAN_3.data(), GAUSSIAN_5.data(), GAUSSIAN_7.data(), GAUSSIAN_9.data() },
+	{ LAPLACIAN_OF_GAUSSIAN_3.data(), LAPLACIAN_OF_GAUSSIAN_5.data(), LAPLACIAN_OF_GAUSSIAN_7.data(), LAPLACIAN_OF_GAUSSIAN_9.data() }
+};
+
+// filter declaration ends
+
+// smallest band of rows handed to one thread by the spatial filters
+static const int ROW_BAND = 16;
+
+// compile-time specialized convolution
+
+// converts a convolution sum to the output type
+// 8-bit output is clamped to 0-255 and truncated, 16-bit output saturates, floating point is kept as is
+template <class Out>
+inline Out store(double pixel) {
+	if constexpr (std::is_same_v<Out, uchar>) {
+		if (pixel > 255) pixel = 255;
+		else if (pixel < 0) pixel = 0;
+		return static_cast<uchar>(pixel);
+	}
+	else if constexpr (std::is_same_v<Out, short>) {
+		return cv::saturate_cast<short>(pixel);
+	}
+	else {
+		return static_cast<Out>(pixel);
+	}
+}
+
+// adds a single tap of the built-in kernel `K`; zero taps vanish at compile time
+// `j` indexes interleaved samples, so horizontal neighbours are `cn` samples apart
+template <class In, int N, const Coeffs<N>& K, int T>
+inline void tap(double& pixel, const In* const* rows, int j, int cn) {
+	if constexpr (K[T] != 0) {
+		pixel += K[T] * static_cast<double>(rows[T / N][j + T % N * cn]);
+	}
+}
+
+// fully unrolled sum over every tap of `K`, in the same order as the generic loop
+template <class In, int N, const Coeffs<N>& K, int... T>
+inline double taps(const In* const* rows, int j, int cn, std::integer_sequence<int, T...>) {
+	double pixel = 0;
+	(tap<In, N, K, T>(pixel, rows, j, cn), ...);
+	return pixel;
+}
 
-Vec3d FILTERS = {
-	Vec2d(), MEAN, Vec2d(), PREWITT_H, PREWITT_V, SOBEL_H, SOBEL_V, SOBEL_D,
-	LAPLACIAN, GAUSSIAN, LAPLACIAN_OF_GAUSSIAN
+// convolves the interior (where the whole window fits) of rows [rowBegin, rowEnd) with `K`
+// every channel of an interleaved row is handled by the same loop
+template <class In, class Out, int N, const Coeffs<N>& K>
+void convFixed(const cv::Mat& image, cv::Mat& result, int rowBegin, int rowEnd) {
+	const int size2 = N / 2;
+	const int cn = image.channels();
+	const In* rows[N];
+	for (int i = std::max(rowBegin, size2); i < std::min(rowEnd, image.rows - size2); i++) {
+		for (int k = 0; k < N; k++) rows[k] = image.ptr<In>(i - size2 + k);
+		Out* out = result.ptr<Out>(i);
+		for (int j = size2 * cn; j < (image.cols - size2) * cn; j++) {
+			out[j] = store<Out>(taps<In, N, K>(rows, j - size2 * cn, cn, std::make_integer_sequence<int, N * N>()));
+		}
+	}
+}
+
+// SPECIALIZED<In, Out>[filterType][filterSize] mirrors FILTERS, with HIGH_PASS in an extra last row
+template <class In, class Out>
+static const SpecializedConv SPECIALIZED[12][4] = {
+	{ nullptr, nullptr, nullptr, nullptr },
+	{ convFixed<In, Out, 3, MEAN_3>, convFixed<In, Out, 5, MEAN_5>, convFixed<In, Out, 7, MEAN_7>, convFixed<In, Out, 9, MEAN_9> },
+	{ nullptr, nullptr, nullptr, nullptr },
+	{ convFixed<In, Out, 3, PREWITT_H_3>, convFixed<In, Out, 5, PREWITT_H_5>,
+	  convFixed<In, Out, 7, PREWITT_H_7>, convFixed<In, Out, 9, PREWITT_H_9> },
+	{ convFixed<In, Out, 3, PREWITT_V_3>, convFixed<In, Out, 5, PREWITT_V_5>,
+	  convFixed<In, Out, 7, PREWITT_V_7>, convFixed<In, Out, 9, PREWITT_V_9> },
+	{ convFixed<In, Out, 3, SOBEL_H_3>, convFixed<In, Out, 5, SOBEL_H_5>, convFixed<In, Out, 7, SOBEL_H_7>, convFixed<In, Out, 9, SOBEL_H_9> },
+	{ convFixed<In, Out, 3, SOBEL_V_3>, convFixed<In, Out, 5, SOBEL_V_5>, convFixed<In, Out, 7, SOBEL_V_7>, convFixed<In, Out, 9, SOBEL_V_9> },
+	{ convFixed<In, Out, 3, SOBEL_D_3>, convFixed<In, Out, 5, SOBEL_D_5>, convFixed<In, Out, 7, SOBEL_D_7>, convFixed<In, Out, 9, SOBEL_D_9> },
+	{ convFixed<In, Out, 3, LAPLACIAN_3>, convFixed<In, Out, 5, LAPLACIAN_5>,
+	  convFixed<In, Out, 7, LAPLACIAN_7>, convFixed<In, Out, 9, LAPLACIAN_9> },
+	{ convFixed<In, Out, 3, GAUSSIAN_3>, convFixed<In, Out, 5, GAUSSIAN_5>, convFixed<In, Out, 7, GAUSSIAN_7>, convFixed<In, Out, 9, GAUSSIAN_9> },
+	{ convFixed<In, Out, 3, LAPLACIAN_OF_GAUSSIAN_3>, convFixed<In, Out, 5, LAPLACIAN_OF_GAUSSIAN_5>,
+	  convFixed<In, Out, 7, LAPLACIAN_OF_GAUSSIAN_7>, convFixed<In, Out, 9, LAPLACIAN_OF_GAUSSIAN_9> },
+	{ convFixed<In, Out, 3, HIGH_PASS>, nullptr, nullptr, nullptr }
 };
 
+// index of HIGH_PASS in SPECIALIZED
+static const int HIGH_PASS_BUILTIN = 11 * 4;
+
+// every table of specializations is compiled in, so only the common pipelines get one:
+// 8-bit input to any output but double, and float to float
+template <class In, class Out>
+constexpr bool HAS_SPECIALIZED = std::is_same_v<In, uchar> ? !std::is_same_v<Out, double>
+                                                          : std::is_same_v<In, float> && std::is_same_v<Out, float>;
+
+// specialization of the built-in kernel `builtin` for the given input and output types, if any
+template <class In, class Out>
+static SpecializedConv findSpecialized(int builtin) {
+	if constexpr (HAS_SPECIALIZED<In, Out>) {
+		return (builtin < 0) ? nullptr : SPECIALIZED<In, Out>[builtin / 4][builtin % 4];
+	}
+	else {
+		return nullptr;
+	}
+}
+
+// finds the built-in kernel a runtime kernel matches, as filterType * 4 + filterSize, or -1
+static int findBuiltin(int size, const double* matrix) {
+	if (size == 3 && std::equal(HIGH_PASS.begin(), HIGH_PASS.end(), matrix)) {
+		return HIGH_PASS_BUILTIN;
+	}
+	if (size < 3 || size > 9 || size % 2 == 0) return -1;
+	int filterSize = (size - 3) / 2;
+	for (int filterType = 0; filterType < 11; filterType++) {
+		const double* builtin = FILTERS[filterType][filterSize];
+		if (builtin && std::equal(builtin, builtin + size * size, matrix)) {
+			return filterType * 4 + filterSize;
+		}
+	}
+	return -1;
+}
+
+// runs `fn` with a value of the element type of `depth`
+template <class Fn>
+static void dispatchDepth(int depth, const Fn& fn) {
+	switch (depth) {
+	case CV_8U: fn(uchar()); break;
+	case CV_16S: fn(short()); break;
+	case CV_32F: fn(float()); break;
+	case CV_64F: fn(double()); break;
+	default: throw std::runtime_error("Unsupported depth for Kernel::conv!");
+	}
+}
+
+// rows x cols complex matrix of zeros, reallocated only when it has to grow
+CMatrix& FilterWorkspace::padded(int rows, int cols) {
+	paddedScratch.reset(rows, cols);
+	return paddedScratch;
+}
+
 // default constructor for Kernel
-Kernel::Kernel() : size(0) {}
+Kernel::Kernel() : size(0), builtin(-1), taps(0), exactFactors(false) {}
 
 // parametrized constructor for Kernel
 Kernel::Kernel(int filterType, int filterSize) : size(filterSize * 2 + 3) {
-	matrix = FILTERS[filterType][filterSize];
+	const double* builtin = FILTERS[filterType][filterSize];
+	if (builtin) matrix.assign(builtin, builtin + size * size);
+	prepare();
 }
 
-Kernel::Kernel(int size_, std::vector<double>& matrix_) : size(size_), matrix(matrix_) {}
+Kernel::Kernel(int size_, const std::vector<double>& matrix_) : size(size_), matrix(matrix_) {
+	prepare();
+}
+
+Kernel::Kernel(int size_, const double* matrix_) : size(size_), matrix(matrix_, matrix_ + size_ * size_) {
+	prepare();
+}
+
+// looks up the matching built-in kernel and factors the kernel, if it is separable
+void Kernel::prepare() {
+	builtin = matrix.empty() ? -1 : findBuiltin(size, matrix.data());
+	taps = static_cast<int>(std::count_if(matrix.begin(), matrix.end(), [](double v) { return v != 0; }));
+	exactFactors = false;
+	if (matrix.empty()) return;
+
+	// a kernel is separable when it has rank 1, i.e. every row is a multiple of the pivot row
+	// the tolerance absorbs the 8 decimals the built-in tables are rounded to
+	int pivot = static_cast<int>(std::max_element(matrix.begin(), matrix.end(), [](double a, double b) {
+		return fabs(a) < fabs(b);
+	}) - matrix.begin());
+	int p = pivot / size, q = pivot % size;
+	double peak = matrix[pivot];
+	if (peak == 0) return;
+	std::vector<double> row(matrix.begin() + p * size, matrix.begin() + (p + 1) * size);
+	std::vector<double> col(size);
+	for (int i = 0; i < size; i++) col[i] = matrix[i * size + q] / peak;
+	double residual = 0;
+	for (int i = 0; i < size; i++) {
+		for (int j = 0; j < size; j++) residual = std::max(residual, fabs(col[i] * row[j] - matrix[i * size + j]));
+	}
+	if (residual > 1e-7 * fabs(peak)) return;
+	rowFactor = row;
+	colFactor = col;
+	exactFactors = residual <= 1e-12 * fabs(peak);
+}
+
+// Get size of the Kernel
+int Kernel::getSize() const {
+	return size;
+}
+
+// Check whether the Kernel is the outer product of a column and a row
+bool Kernel::isSeparable() const {
+	return !rowFactor.empty();
+}
 
 // Get value at any given position in Kernel
-double Kernel::at(int i, int j) {
+double Kernel::at(int i, int j) const {
 	i += size / 2;
 	j += size / 2;
 	return matrix[size * i + j];
 }
 
-// performs convolution with cv::Mat object
-cv::Mat Kernel::conv(cv::Mat& image) {
-	cv::Mat result = image.clone();
+// convolves rows [rowBegin, rowEnd) of `image` into `result`
+template <class In, class Out>
+void Kernel::convRows(const cv::Mat& image, cv::Mat& result, int rowBegin, int rowEnd) {
 	int size2 = size / 2;
+	int cn = image.channels();
 
-	for (int i = 0; i < result.rows; i++) {
+	// the interior is handed over to the compile-time specialization, if any;
+	// the generic loop below then only needs to visit the border
+	SpecializedConv special = findSpecialized<In, Out>(builtin);
+	bool interior = special && image.rows > 2 * size2 && image.cols > 2 * size2;
+	if (interior) special(image, result, rowBegin, rowEnd);
+
+	for (int i = rowBegin; i < rowEnd; i++) {
+		bool borderRow = i < size2 || i >= result.rows - size2;
 		for (int j = 0; j < result.cols; j++) {
-			double pixel = 0;
-			for (int dx = -size2; dx <= size2; dx++) {
-				for (int dy = -size2; dy <= size2; dy++) {
-					int nx = i + dx;
-					int ny = j + dy;
-					if (nx >= 0 && nx < result.rows && ny >= 0 && ny < result.cols) {
-						pixel += at(dx, dy) * static_cast<int>(image.at<uchar>(nx, ny));
+			if (interior && !borderRow && j == size2) {
+				j = result.cols - size2 - 1;
+				continue;
+			}
+			for (int c = 0; c < cn; c++) {
+				double pixel = 0;
+				for (int dx = -size2; dx <= size2; dx++) {
+					for (int dy = -size2; dy <= size2; dy++) {
+						int nx = i + dx;
+						int ny = j + dy;
+						if (nx >= 0 && nx < result.rows && ny >= 0 && ny < result.cols) {
+							pixel += at(dx, dy) * static_cast<double>(image.ptr<In>(nx)[ny * cn + c]);
+						}
 					}
 				}
+				result.ptr<Out>(i)[j * cn + c] = store<Out>(pixel);
 			}
-			if (pixel > 255) pixel = 255;
-			else if (pixel < 0) pixel = 0;
-			result.at<uchar>(i, j) = static_cast<uchar>(pixel);
 		}
 	}
+}
+
+// convolves `image` with the rank-1 factors of the kernel: rows first, then columns
+// interleaved channels are filtered together, with horizontal neighbours `cn` samples apart
+template <class In, class Out>
+void Kernel::convSeparable(const cv::Mat& image, cv::Mat& result, FilterWorkspace& ws) {
+	int rows = image.rows;
+	int cn = image.channels();
+	int cols = image.cols * cn;
+	int size2 = size / 2;
+	double* horizontal = ws.buffer<double>(static_cast<size_t>(rows) * cols);
+	ws.reserve<double>(cols);
+
+	parallelFor(0, rows, [&](int rowBegin, int rowEnd) {
+		for (int i = rowBegin; i < rowEnd; i++) {
+			const In* src = image.ptr<In>(i);
+			double* dst = horizontal + static_cast<size_t>(i) * cols;
+			for (int j = 0; j < cols; j++) {
+				double pixel = 0;
+				int x = j / cn;
+				for (int dy = std::max(-size2, -x); dy <= std::min(size2, image.cols - 1 - x); dy++) {
+					pixel += rowFactor[dy + size2] * src[j + dy * cn];
+				}
+				dst[j] = pixel;
+			}
+		}
+	}, ROW_BAND);
+
+	// the vertical pass accumulates whole rows, so that every access is sequential
+	parallelFor(0, rows, [&](int rowBegin, int rowEnd) {
+		double* sum = ws.scratch<double>(getThreadIndex());
+		for (int i = rowBegin; i < rowEnd; i++) {
+			std::fill(sum, sum + cols, 0.0);
+			for (int dx = std::max(-size2, -i); dx <= std::min(size2, rows - 1 - i); dx++) {
+				const double* src = horizontal + static_cast<size_t>(i + dx) * cols;
+				double weight = colFactor[dx + size2];
+				for (int j = 0; j < cols; j++) sum[j] += weight * src[j];
+			}
+			Out* out = result.ptr<Out>(i);
+			for (int j = 0; j < cols; j++) out[j] = store<Out>(sum[j]);
+		}
+	}, ROW_BAND);
+}
+
+// convolves `image` by multiplication in the frequency domain, one channel at a time
+// the image is zero-padded far enough that the circular wrap-around only ever reads zeros,
+// which matches the zero border of the direct method
+template <class In, class Out>
+void Kernel::convFFT(const cv::Mat& image, cv::Mat& result, FilterWorkspace& ws) {
+	int cn = image.channels();
+	int size2 = size / 2;
+	std::pair<int, int> padded = fftSize(image.rows + size2, image.cols + size2);
+	int n = padded.first;
+	int m = padded.second;
+
+	// the kernel spectrum only depends on the padded size, so it is kept for later calls
+	auto kernelSpectrum = std::atomic_load(&spectrum);
+	if (!kernelSpectrum || kernelSpectrum->rows() != n || kernelSpectrum->cols() != m) {
+		auto fresh = std::make_shared<CMatrix>(n, m);
+		// Kernel::conv is a correlation, so tap (dx, dy) goes to (-dx, -dy)
+		for (int dx = -size2; dx <= size2; dx++) {
+			for (int dy = -size2; dy <= size2; dy++) {
+				(*fresh)[((n - dx) % n + n) % n][((m - dy) % m + m) % m] += at(dx, dy);
+			}
+		}
+		fft(*fresh, false);
+		kernelSpectrum = fresh;
+		std::atomic_store(&spectrum, kernelSpectrum);
+	}
+
+	for (int c = 0; c < cn; c++) {
+		CMatrix& mat = ws.padded(n, m);
+		for (int i = 0; i < image.rows; i++) {
+			const In* src = image.ptr<In>(i);
+			for (int j = 0; j < image.cols; j++) mat[i][j] = static_cast<double>(src[j * cn + c]);
+		}
+		fft(mat, false);
+		for (int i = 0; i < n; i++) {
+			for (int j = 0; j < m; j++) mat[i][j] *= (*kernelSpectrum)[i][j];
+		}
+		fft(mat, true);
+		for (int i = 0; i < image.rows; i++) {
+			Out* out = result.ptr<Out>(i);
+			for (int j = 0; j < image.cols; j++) out[j * cn + c] = store<Out>(mat[i][j].real());
+		}
+	}
+}
+
+// benchmark table of the cost model used by CONV_AUTO, in nanoseconds
+// measured single-threaded on 1024x1024 images with the built-in and random kernels
+// the transforms of CONV_FFT are costed by fftCost, measured on the same machine
+static const double COST_SPECIALIZED_TAP = 0.55; // per output pixel and non-zero tap, specialized direct
+static const double COST_GENERIC_TAP = 2.2;      // per output pixel and tap, generic direct
+static const double COST_SEPARABLE_PIXEL = 10;   // per output pixel, both separable passes
+static const double COST_SEPARABLE_TAP = 0.42;   // per output pixel and tap of either factor
+static const double COST_FFT_PIXEL = 15;         // per padded pixel, padding, product and copies
+
+// picks the cheapest strategy for convolving a rows x cols image with the kernel
+// factors that only match the kernel to the 8 decimals of the built-in tables (e.g. GAUSSIAN)
+// differ from it by up to about 1e-7 of the result, so they are only picked for integer results,
+// where every strategy agrees within one level
+ConvStrategy Kernel::pickStrategy(int rows, int cols, int depth, int resultDepth) const {
+	if (resultDepth < 0) resultDepth = depth;
+	bool integer = resultDepth == CV_8U || resultDepth == CV_16S;
+	double pixels = static_cast<double>(rows) * cols;
+	bool specialized = false;
+	dispatchDepth(depth, [&](auto in) {
+		dispatchDepth(resultDepth, [&](auto out) {
+			specialized = findSpecialized<decltype(in), decltype(out)>(builtin) != nullptr;
+		});
+	});
+	double direct = specialized ? COST_SPECIALIZED_TAP * taps * pixels : COST_GENERIC_TAP * size * size * pixels;
+	bool factors = isSeparable() && (exactFactors || integer);
+	double separable = factors ? (COST_SEPARABLE_PIXEL + COST_SEPARABLE_TAP * 2 * size) * pixels : direct;
+	// the forward and inverse transforms of the padded image, costed as fftCost estimates them
+	std::pair<int, int> padded = fftSize(rows + size / 2, cols + size / 2);
+	double transform = 2 * fftCost(padded.first, padded.second) + COST_FFT_PIXEL * padded.first * padded.second;
+	if (transform < std::min(direct, separable)) return CONV_FFT;
+	return separable < direct ? CONV_SEPARABLE : CONV_DIRECT;
+}
+
+// convolves `image` of element type `In` into `result` of element type `Out`
+template <class In, class Out>
+void Kernel::convTyped(const cv::Mat& image, cv::Mat& result, ConvStrategy strategy, FilterWorkspace& ws) {
+	if (strategy == CONV_AUTO) strategy = pickStrategy(image.rows, image.cols, image.depth(), result.depth());
+	if (strategy == CONV_SEPARABLE && !isSeparable()) strategy = CONV_DIRECT;
+
+	if (strategy == CONV_FFT) {
+		convFFT<In, Out>(image, result, ws);
+	}
+	else if (strategy == CONV_SEPARABLE) {
+		convSeparable<In, Out>(image, result, ws);
+	}
+	else {
+		parallelFor(0, image.rows, [&](int rowBegin, int rowEnd) {
+			convRows<In, Out>(image, result, rowBegin, rowEnd);
+		}, ROW_BAND);
+	}
+}
+
+// performs convolution with cv::Mat object, keeping the depth of `image`
+cv::Mat Kernel::conv(const cv::Mat& image, ConvStrategy strategy) {
+	return conv(image, image.depth(), strategy);
+}
+
+// performs convolution into a result of the given depth (CV_8U, CV_16S, CV_32F or CV_64F)
+cv::Mat Kernel::conv(const cv::Mat& image, int depth, ConvStrategy strategy) {
+	cv::Mat result;
+	FilterWorkspace ws;
+	conv(image, result, ws, depth, strategy);
 	return result;
 }
 
-// performs median filtering
-cv::Mat median(cv::Mat& image, int size) {
-	cv::Mat result = image.clone();
+// performs convolution into `result`, with the scratch memory of `ws`
+// the image is split in bands of rows filtered on the thread pool
+void Kernel::conv(const cv::Mat& image, cv::Mat& result, FilterWorkspace& ws, int depth, ConvStrategy strategy) {
+	if (depth < 0) depth = image.depth();
+	result.create(image.rows, image.cols, CV_MAKETYPE(depth, image.channels()));
+	dispatchDepth(image.depth(), [&](auto in) {
+		dispatchDepth(depth, [&](auto out) {
+			convTyped<decltype(in), decltype(out)>(image, result, strategy, ws);
+		});
+	});
+}
+
+// converts the output of a wide convolution to 8 bits, exactly as an 8-bit conv would store it
+cv::Mat saturate(const cv::Mat& image) {
+	cv::Mat result(image.rows, image.cols, CV_MAKETYPE(CV_8U, image.channels()));
+	int samples = image.cols * image.channels();
+	dispatchDepth(image.depth(), [&](auto in) {
+		using In = decltype(in);
+		parallelFor(0, image.rows, [&](int rowBegin, int rowEnd) {
+			for (int i = rowBegin; i < rowEnd; i++) {
+				const In* src = image.ptr<In>(i);
+				uchar* out = result.ptr<uchar>(i);
+				for (int j = 0; j < samples; j++) out[j] = store<uchar>(static_cast<double>(src[j]));
+			}
+		}, ROW_BAND);
+	});
+	return result;
+}
+
+// builds a filter bank out of arbitrary kernels
+FilterBank::FilterBank(const std::vector<Kernel>& kernels) : size(1) {
+	for (auto& kernel : kernels) size = std::max(size, kernel.getSize());
 	int size2 = size / 2;
+	for (auto& kernel : kernels) {
+		int k2 = kernel.getSize() / 2;
+		std::vector<std::pair<int, double>> kernelTaps;
+		for (int dx = -k2; dx <= k2; dx++) {
+			for (int dy = -k2; dy <= k2; dy++) {
+				double value = kernel.at(dx, dy);
+				if (value != 0) kernelTaps.push_back({ (dx + size2) * size + (dy + size2), value });
+			}
+		}
+		taps.push_back(kernelTaps);
+	}
+}
 
-	for (int i = 0; i < result.rows; i++) {
-		for (int j = 0; j < result.cols; j++) {
-			std::vector<uchar> pixels;
-			for (int dx = -size2; dx <= size2; dx++) {
-				for (int dy = -size2; dy <= size2; dy++) {
-					int nx = i + dx;
-					int ny = j + dy;
-					if (nx >= 0 && nx < result.rows && ny >= 0 && ny < result.cols) {
-						pixels.push_back(image.at<uchar>(nx, ny));
+// builds a filter bank out of built-in kernels, e.g. { 5, 6, 7 } for the three SOBEL kernels
+FilterBank::FilterBank(const std::vector<int>& filterTypes, int filterSize) :
+	FilterBank([&] {
+		std::vector<Kernel> kernels;
+		for (int filterType : filterTypes) kernels.emplace_back(filterType, filterSize);
+		return kernels;
+	}()) {}
+
+// applies every kernel of the bank to `image`
+std::vector<cv::Mat> FilterBank::apply(const cv::Mat& image, cv::Mat* magnitude, cv::Mat* orientation) {
+	if (image.type() != CV_8UC1) throw std::runtime_error("FilterBank takes CV_8UC1 images!");
+	int rows = image.rows;
+	int cols = image.cols;
+	int size2 = size / 2;
+	int count = static_cast<int>(taps.size());
+	bool fused = magnitude || orientation;
+	if (fused && count < 2) throw std::runtime_error("Gradient of a FilterBank needs two kernels!");
+
+	std::vector<cv::Mat> responses(count);
+	for (auto& response : responses) response.create(rows, cols, CV_16SC1);
+	if (magnitude) magnitude->create(rows, cols, CV_32FC1);
+	if (orientation) orientation->create(rows, cols, CV_32FC1);
+
+	parallelFor(0, rows, [&](int rowBegin, int rowEnd) {
+		std::vector<double> window(size * size);
+		std::vector<double> sums(count);
+		for (int i = rowBegin; i < rowEnd; i++) {
+			bool interiorRow = i >= size2 && i < rows - size2;
+			for (int j = 0; j < cols; j++) {
+				// loading the neighbourhood once, with zeros outside the image
+				if (interiorRow && j >= size2 && j < cols - size2) {
+					for (int dx = 0; dx < size; dx++) {
+						const uchar* src = image.ptr<uchar>(i - size2 + dx) + j - size2;
+						for (int dy = 0; dy < size; dy++) window[dx * size + dy] = src[dy];
 					}
 				}
+				else {
+					for (int dx = 0; dx < size; dx++) {
+						for (int dy = 0; dy < size; dy++) {
+							int nx = i + dx - size2;
+							int ny = j + dy - size2;
+							bool inside = nx >= 0 && nx < rows && ny >= 0 && ny < cols;
+							window[dx * size + dy] = inside ? image.at<uchar>(nx, ny) : 0;
+						}
+					}
+				}
+
+				for (int k = 0; k < count; k++) {
+					double pixel = 0;
+					for (auto& tap : taps[k]) pixel += tap.second * window[tap.first];
+					sums[k] = pixel;
+					responses[k].at<short>(i, j) = cv::saturate_cast<short>(pixel);
+				}
+				if (fused) {
+					if (magnitude) magnitude->at<float>(i, j) = static_cast<float>(hypot(sums[0], sums[1]));
+					if (orientation) orientation->at<float>(i, j) = static_cast<float>(atan2(sums[1], sums[0]));
+				}
+			}
+		}
+	}, ROW_BAND);
+	return responses;
+}
+
+// histogram layout used by the median filter: 256 fine bins grouped in 16 coarse bins
+static const int FINE_BINS = 256;
+static const int COARSE_BINS = 16;
+static const int COARSE_SHIFT = 4;
+
+// kernel histogram of the median filter, after Perreault and Hebert
+// the coarse level is kept exact while every 16-bin fine segment is brought
+// up to date lazily, only when the rank search descends into it
+struct KernelHistogram {
+	int coarse[COARSE_BINS];
+	int fine[FINE_BINS];
+	int last[COARSE_BINS]; // column at which each fine segment was last updated
+
+	// brings fine segment `b` up to date for the window centred at column `x`
+	// `colFine` holds the column histograms of one channel, `cn` histograms apart
+	void refresh(int b, int x, int size2, int cols, const uint16_t* colFine, int cn) {
+		int* seg = fine + (b << COARSE_SHIFT);
+		auto column = [&](int c) { return colFine + c * cn * FINE_BINS + (b << COARSE_SHIFT); };
+		if (x - last[b] > 2 * size2) {
+			std::fill(seg, seg + COARSE_BINS, 0);
+			for (int c = std::max(x - size2, 0); c <= std::min(x + size2, cols - 1); c++) {
+				const uint16_t* col = column(c);
+				for (int v = 0; v < COARSE_BINS; v++) seg[v] += col[v];
+			}
+		}
+		else {
+			for (int c = last[b] + size2 + 1; c <= std::min(x + size2, cols - 1); c++) {
+				const uint16_t* col = column(c);
+				for (int v = 0; v < COARSE_BINS; v++) seg[v] += col[v];
+			}
+			for (int c = std::max(last[b] - size2, 0); c < x - size2; c++) {
+				const uint16_t* col = column(c);
+				for (int v = 0; v < COARSE_BINS; v++) seg[v] -= col[v];
+			}
+		}
+		last[b] = x;
+	}
+};
+
+// median filters rows [rowBegin, rowEnd) of `image` into `result`
+// each output pixel is the value of rank `percentile` among the in-bounds pixels of its window
+// interleaved channels keep one column histogram per sample and one kernel histogram each
+static void medianRows(const cv::Mat& image, cv::Mat& result, int size, double percentile, int rowBegin, int rowEnd,
+                       FilterWorkspace& ws) {
+	int size2 = size / 2;
+	int rows = image.rows;
+	int cols = image.cols;
+	int cn = image.channels();
+
+	// per-column histograms over the rows of the current window
+	size_t fineCount = static_cast<size_t>(cols) * cn * FINE_BINS;
+	size_t coarseCount = static_cast<size_t>(cols) * cn * COARSE_BINS;
+	uint16_t* colFine = ws.scratch<uint16_t>(getThreadIndex());
+	uint16_t* colCoarse = colFine + fineCount;
+	std::fill(colFine, colFine + fineCount + coarseCount, 0);
+	auto update = [&](int row, int delta) {
+		const uchar* src = image.ptr<uchar>(row);
+		for (int c = 0; c < cols * cn; c++) {
+			colFine[c * FINE_BINS + src[c]] += delta;
+			colCoarse[c * COARSE_BINS + (src[c] >> COARSE_SHIFT)] += delta;
+		}
+	};
+	for (int r = std::max(rowBegin - size2, 0); r < std::min(rowBegin + size2, rows - 1) + 1; r++) update(r, 1);
+
+	KernelHistogram hists[4]; // one per channel, median() takes at most 4
+	for (int i = rowBegin; i < rowEnd; i++) {
+		if (i > rowBegin) {
+			if (i - size2 - 1 >= 0) update(i - size2 - 1, -1);
+			if (i + size2 < rows) update(i + size2, 1);
+		}
+		int windowRows = std::min(i + size2, rows - 1) - std::max(i - size2, 0) + 1;
+
+		for (int ch = 0; ch < cn; ch++) {
+			KernelHistogram& hist = hists[ch];
+			std::fill(hist.coarse, hist.coarse + COARSE_BINS, 0);
+			std::fill(hist.last, hist.last + COARSE_BINS, -2 * size2 - 2);
+			for (int c = 0; c <= std::min(size2, cols - 1); c++) {
+				for (int b = 0; b < COARSE_BINS; b++) hist.coarse[b] += colCoarse[(c * cn + ch) * COARSE_BINS + b];
+			}
+		}
+
+		uchar* out = result.ptr<uchar>(i);
+		for (int j = 0; j < cols; j++) {
+			int windowCols = std::min(j + size2, cols - 1) - std::max(j - size2, 0) + 1;
+			int rank = static_cast<int>(percentile * (windowRows * windowCols - 1) + 0.5);
+			for (int ch = 0; ch < cn; ch++) {
+				KernelHistogram& hist = hists[ch];
+				if (j > 0) {
+					if (j + size2 < cols) {
+						const uint16_t* col = colCoarse + ((j + size2) * cn + ch) * COARSE_BINS;
+						for (int b = 0; b < COARSE_BINS; b++) hist.coarse[b] += col[b];
+					}
+					if (j - size2 - 1 >= 0) {
+						const uint16_t* col = colCoarse + ((j - size2 - 1) * cn + ch) * COARSE_BINS;
+						for (int b = 0; b < COARSE_BINS; b++) hist.coarse[b] -= col[b];
+					}
+				}
+
+				// locating the coarse bin holding `rank`, then the fine bin inside it
+				int b = 0, below = 0;
+				while (below + hist.coarse[b] <= rank) below += hist.coarse[b++];
+				hist.refresh(b, j, size2, cols, colFine + ch * FINE_BINS, cn);
+				const int* seg = hist.fine + (b << COARSE_SHIFT);
+				int v = 0;
+				while (below + seg[v] <= rank) below += seg[v++];
+				out[j * cn + ch] = static_cast<uchar>((b << COARSE_SHIFT) + v);
+			}
+		}
+	}
+}
+
+// sorting-network medians for 3x3 and 5x5 windows
+// every window operation runs on a whole vector of neighbouring output pixels
+
+// 8-bit lane operations, one pixel at a time (also handles the tail of each row)
+struct ScalarU8 {
+	using T = uchar;
+	static const int WIDTH = 1;
+	static T load(const uchar* p) { return *p; }
+	static void store(uchar* p, T v) { *p = v; }
+	static T min(T a, T b) { return std::min(a, b); }
+	static T max(T a, T b) { return std::max(a, b); }
+};
+
+#if defined(__AVX2__)
+// 8-bit lane operations, 32 pixels at a time
+struct SimdU8 {
+	using T = __m256i;
+	static const int WIDTH = 32;
+	static T load(const uchar* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+	static void store(uchar* p, T v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+	static T min(T a, T b) { return _mm256_min_epu8(a, b); }
+	static T max(T a, T b) { return _mm256_max_epu8(a, b); }
+};
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+// 8-bit lane operations, 16 pixels at a time
+struct SimdU8 {
+	using T = __m128i;
+	static const int WIDTH = 16;
+	static T load(const uchar* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+	static void store(uchar* p, T v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+	static T min(T a, T b) { return _mm_min_epu8(a, b); }
+	static T max(T a, T b) { return _mm_max_epu8(a, b); }
+};
+#else
+using SimdU8 = ScalarU8;
+#endif
+
+// branchless compare-exchange: `a` receives the minimum and `b` the maximum
+template <class V>
+inline void sort2(typename V::T& a, typename V::T& b) {
+	typename V::T t = V::min(a, b);
+	b = V::max(a, b);
+	a = t;
+}
+
+// sorts every column of the `N` source rows into `N` planes, from columns `j` to `end`
+// returns the first column left unprocessed
+template <class V, int N>
+static int presortColumns(const uchar* const* src, uchar* const* planes, int j, int end) {
+	for (; j + V::WIDTH <= end; j += V::WIDTH) {
+		typename V::T w[N];
+		for (int k = 0; k < N; k++) w[k] = V::load(src[k] + j);
+		if constexpr (N == 3) {
+			sort2<V>(w[0], w[1]); sort2<V>(w[1], w[2]); sort2<V>(w[0], w[1]);
+		}
+		else {
+			sort2<V>(w[0], w[1]); sort2<V>(w[3], w[4]); sort2<V>(w[2], w[4]);
+			sort2<V>(w[2], w[3]); sort2<V>(w[1], w[4]); sort2<V>(w[0], w[3]);
+			sort2<V>(w[0], w[2]); sort2<V>(w[1], w[3]); sort2<V>(w[1], w[2]);
+		}
+		for (int k = 0; k < N; k++) V::store(planes[k] + j, w[k]);
+	}
+	return j;
+}
+
+// 3x3 medians of presorted columns: the median of the largest minimum,
+// the median of the medians and the smallest maximum
+// `j` indexes interleaved samples, so neighbouring columns are `cn` samples apart
+template <class V>
+static int medianWindows3(const uchar* const* planes, uchar* out, int j, int end, int cn) {
+	for (; j + V::WIDTH <= end; j += V::WIDTH) {
+		typename V::T lo = V::max(V::max(V::load(planes[0] + j - cn), V::load(planes[0] + j)), V::load(planes[0] + j + cn));
+		typename V::T hi = V::min(V::min(V::load(planes[2] + j - cn), V::load(planes[2] + j)), V::load(planes[2] + j + cn));
+		typename V::T a = V::load(planes[1] + j - cn), mid = V::load(planes[1] + j), c = V::load(planes[1] + j + cn);
+		sort2<V>(a, mid); mid = V::max(a, V::min(mid, c));
+		sort2<V>(lo, mid); mid = V::max(lo, V::min(mid, hi));
+		V::store(out + j, mid);
+	}
+	return j;
+}
+
+// 5x5 medians of presorted columns
+// w[r][c] is the value of rank r in column c of the window; sorting the rows as well leaves
+// 13 candidates, and a pruned odd-even merge network selects their median into w[2][2]
+// (verified exhaustively over 0-1 inputs)
+template <class V>
+static int medianWindows5(const uchar* const* planes, uchar* out, int j, int end, int cn) {
+	for (; j + V::WIDTH <= end; j += V::WIDTH) {
+		typename V::T w[5][5];
+		for (int r = 0; r < 5; r++) {
+			for (int c = 0; c < 5; c++) w[r][c] = V::load(planes[r] + j + (c - 2) * cn);
+		}
+
+		// sorting each row
+		sort2<V>(w[0][0], w[0][1]);
+		sort2<V>(w[0][3], w[0][4]);
+		sort2<V>(w[0][2], w[0][4]);
+		w[0][3] = V::max(w[0][2], w[0][3]);
+		sort2<V>(w[0][1], w[0][4]);
+		w[0][3] = V::max(w[0][0], w[0][3]);
+		w[0][3] = V::max(w[0][1], w[0][3]);
+		sort2<V>(w[1][0], w[1][1]);
+		sort2<V>(w[1][3], w[1][4]);
+		sort2<V>(w[1][2], w[1][4]);
+		sort2<V>(w[1][2], w[1][3]);
+		sort2<V>(w[1][1], w[1][4]);
+		sort2<V>(w[1][0], w[1][3]);
+		w[1][2] = V::max(w[1][0], w[1][2]);
+		sort2<V>(w[1][1], w[1][3]);
+		w[1][2] = V::max(w[1][1], w[1][2]);
+		sort2<V>(w[2][0], w[2][1]);
+		sort2<V>(w[2][3], w[2][4]);
+		sort2<V>(w[2][2], w[2][4]);
+		sort2<V>(w[2][2], w[2][3]);
+		w[2][1] = V::min(w[2][1], w[2][4]);
+		sort2<V>(w[2][0], w[2][3]);
+		w[2][2] = V::max(w[2][0], w[2][2]);
+		sort2<V>(w[2][1], w[2][3]);
+		sort2<V>(w[2][1], w[2][2]);
+		sort2<V>(w[3][0], w[3][1]);
+		sort2<V>(w[3][3], w[3][4]);
+		sort2<V>(w[3][2], w[3][4]);
+		sort2<V>(w[3][2], w[3][3]);
+		w[3][1] = V::min(w[3][1], w[3][4]);
+		sort2<V>(w[3][0], w[3][3]);
+		sort2<V>(w[3][0], w[3][2]);
+		w[3][1] = V::min(w[3][1], w[3][3]);
+		sort2<V>(w[3][1], w[3][2]);
+		sort2<V>(w[4][0], w[4][1]);
+		sort2<V>(w[4][3], w[4][4]);
+		sort2<V>(w[4][2], w[4][4]);
+		sort2<V>(w[4][2], w[4][3]);
+		w[4][1] = V::min(w[4][1], w[4][4]);
+		sort2<V>(w[4][0], w[4][3]);
+		sort2<V>(w[4][0], w[4][2]);
+		w[4][1] = V::min(w[4][1], w[4][3]);
+		w[4][1] = V::min(w[4][1], w[4][2]);
+
+		// selecting the median of the 13 candidates
+		sort2<V>(w[1][4], w[2][1]);
+		sort2<V>(w[3][2], w[4][0]);
+		sort2<V>(w[0][3], w[1][2]);
+		sort2<V>(w[0][4], w[1][3]);
+		w[2][1] = V::min(w[2][1], w[2][3]);
+		sort2<V>(w[0][4], w[1][2]);
+		sort2<V>(w[2][1], w[2][2]);
+		sort2<V>(w[3][1], w[3][2]);
+		sort2<V>(w[0][3], w[1][4]);
+		sort2<V>(w[0][4], w[2][1]);
+		sort2<V>(w[1][2], w[1][4]);
+		sort2<V>(w[1][3], w[2][1]);
+		sort2<V>(w[0][4], w[1][2]);
+		sort2<V>(w[1][3], w[1][4]);
+		sort2<V>(w[2][1], w[2][2]);
+		sort2<V>(w[4][0], w[4][1]);
+		w[3][0] = V::max(w[0][3], w[3][0]);
+		w[3][1] = V::max(w[0][4], w[3][1]);
+		w[3][2] = V::max(w[1][2], w[3][2]);
+		w[1][3] = V::min(w[1][3], w[4][0]);
+		w[1][4] = V::min(w[1][4], w[4][1]);
+		w[3][0] = V::max(w[1][4], w[3][0]);
+		w[2][1] = V::min(w[2][1], w[3][1]);
+		w[2][2] = V::min(w[2][2], w[3][2]);
+		w[2][1] = V::max(w[1][3], w[2][1]);
+		w[2][2] = V::min(w[2][2], w[3][0]);
+		w[2][2] = V::max(w[2][1], w[2][2]);
+
+		V::store(out + j, w[2][2]);
+	}
+	return j;
+}
+
+// rank `percentile` among the in-bounds pixels of channel `ch` in the window around (i, j),
+// by direct selection
+static uchar selectAt(const cv::Mat& image, int i, int j, int ch, int size2, double percentile, uchar* pixels) {
+	int cn = image.channels();
+	int count = 0;
+	for (int x = std::max(i - size2, 0); x <= std::min(i + size2, image.rows - 1); x++) {
+		for (int y = std::max(j - size2, 0); y <= std::min(j + size2, image.cols - 1); y++) {
+			pixels[count++] = image.ptr<uchar>(x)[y * cn + ch];
+		}
+	}
+	int rank = static_cast<int>(percentile * (count - 1) + 0.5);
+	std::nth_element(pixels, pixels + rank, pixels + count);
+	return pixels[rank];
+}
+
+// median filters rows [rowBegin, rowEnd) of `image` into `result` with a 3x3 or 5x5 sorting network
+// interleaved channels share the vector lanes; windows that cross the border are left to direct selection
+static void medianNetworkRows(const cv::Mat& image, cv::Mat& result, int size, int rowBegin, int rowEnd,
+                              FilterWorkspace& ws) {
+	int size2 = size / 2;
+	int rows = image.rows;
+	int cols = image.cols;
+	int cn = image.channels();
+	int samples = cols * cn;
+	uchar* buffer = ws.scratch<uchar>(getThreadIndex());
+	const uchar* src[5];
+	uchar* planes[5];
+	uchar pixels[25];
+	for (int k = 0; k < size; k++) planes[k] = buffer + k * samples;
+
+	for (int i = rowBegin; i < rowEnd; i++) {
+		uchar* out = result.ptr<uchar>(i);
+		if (i < size2 || i >= rows - size2 || cols < size) {
+			for (int j = 0; j < cols; j++) {
+				for (int ch = 0; ch < cn; ch++) out[j * cn + ch] = selectAt(image, i, j, ch, size2, 0.5, pixels);
+			}
+			continue;
+		}
+		for (int k = 0; k < size; k++) src[k] = image.ptr<uchar>(i - size2 + k);
+		int j = 0, begin = size2 * cn, end = samples - size2 * cn;
+		if (size == 3) {
+			j = presortColumns<SimdU8, 3>(src, planes, j, samples);
+			presortColumns<ScalarU8, 3>(src, planes, j, samples);
+			j = medianWindows3<SimdU8>(planes, out, begin, end, cn);
+			medianWindows3<ScalarU8>(planes, out, j, end, cn);
+		}
+		else {
+			j = presortColumns<SimdU8, 5>(src, planes, j, samples);
+			presortColumns<ScalarU8, 5>(src, planes, j, samples);
+			j = medianWindows5<SimdU8>(planes, out, begin, end, cn);
+			medianWindows5<ScalarU8>(planes, out, j, end, cn);
+		}
+		for (int j = 0; j < size2; j++) {
+			for (int ch = 0; ch < cn; ch++) {
+				out[j * cn + ch] = selectAt(image, i, j, ch, size2, 0.5, pixels);
+				out[(cols - 1 - j) * cn + ch] = selectAt(image, i, cols - 1 - j, ch, size2, 0.5, pixels);
 			}
-			std::sort(pixels.begin(), pixels.end());
-			result.at<uchar>(i, j) = pixels[size2];
 		}
 	}
+}
+
+// performs median filtering
+// `percentile` selects another rank instead (0 for minimum, 1 for maximum)
+cv::Mat median(const cv::Mat& image, int size, double percentile) {
+	cv::Mat result;
+	FilterWorkspace ws;
+	median(image, result, ws, size, percentile);
 	return result;
 }
 
+// performs median filtering into `result`, with the scratch memory of `ws`
+void median(const cv::Mat& image, cv::Mat& result, FilterWorkspace& ws, int size, double percentile) {
+	if (image.depth() != CV_8U || image.channels() > 4) throw std::runtime_error("Unsupported image type for median!");
+	result.create(image.rows, image.cols, image.type());
+	int samples = image.cols * image.channels();
+	percentile = std::min(std::max(percentile, 0.0), 1.0);
+	if (percentile == 0.5 && (size == 3 || size == 5)) {
+		ws.reserve<uchar>(static_cast<size_t>(size) * samples); // sorted planes
+		parallelFor(0, image.rows, [&](int rowBegin, int rowEnd) {
+			medianNetworkRows(image, result, size, rowBegin, rowEnd, ws);
+		}, ROW_BAND);
+	}
+	else {
+		// every band rebuilds its column histograms, so bands are kept well above the window height
+		ws.reserve<uint16_t>(static_cast<size_t>(samples) * (FINE_BINS + COARSE_BINS));
+		parallelFor(0, image.rows, [&](int rowBegin, int rowEnd) {
+			medianRows(image, result, size, percentile, rowBegin, rowEnd, ws);
+		}, std::max(ROW_BAND, 4 * size));
+	}
+}
+
 // Performs Adaptive High Boost filtering
-cv::Mat adaptiveHighBoost(cv::Mat& image, double b, double s) {
-	Kernel kernel(3, HIGH_PASS);
-	cv::Mat imageHP = kernel.conv(image);
-	cv::Mat result = imageHP.clone();
-	for (int i = 0; i < result.rows; i++) {
-		for (int j = 0; j < result.cols; j++) {
-			double val = abs(static_cast<double>(imageHP.at<uchar>(i, j)));
-			val /= s * s * (-2);
-			val = 1.0 - exp(val);
-			int newVal = static_cast<int>(b * val * imageHP.at<uchar>(i, j));
-			if (newVal < 0) newVal = 0;
-			else if (newVal > 255) newVal = 255;
-			result.at<uchar>(i, j) = static_cast<uchar>(newVal);
+cv::Mat adaptiveHighBoost(const cv::Mat& image, double b, double s) {
+	cv::Mat result;
+	adaptiveHighBoost(image, result, b, s);
+	return result;
+}
+
+// Performs Adaptive High Boost filtering into `result`
+// the HIGH_PASS stencil, the adaptive gain and the addition of the original image
+// are fused into a single pass over the image, with no intermediate buffers
+void adaptiveHighBoost(const cv::Mat& image, cv::Mat& result, double b, double s) {
+	if (image.depth() != CV_8U || image.channels() > 4) throw std::runtime_error("Unsupported image type for adaptiveHighBoost!");
+	// boosted value of every 8-bit high pass response
+	uchar boost[256];
+	for (int hp = 0; hp < 256; hp++) {
+		double val = abs(static_cast<double>(hp));
+		val /= s * s * (-2);
+		val = 1.0 - exp(val);
+		int newVal = static_cast<int>(b * val * hp);
+		if (newVal < 0) newVal = 0;
+		else if (newVal > 255) newVal = 255;
+		boost[hp] = static_cast<uchar>(newVal);
+	}
+
+	result.create(image.rows, image.cols, image.type());
+	int rows = image.rows;
+	int cn = image.channels();
+	int samples = image.cols * cn;
+	parallelFor(0, rows, [&](int rowBegin, int rowEnd) {
+		for (int i = rowBegin; i < rowEnd; i++) {
+			const uchar* up = (i > 0) ? image.ptr<uchar>(i - 1) : nullptr;
+			const uchar* mid = image.ptr<uchar>(i);
+			const uchar* down = (i + 1 < rows) ? image.ptr<uchar>(i + 1) : nullptr;
+			uchar* out = result.ptr<uchar>(i);
+			// HIGH_PASS is 8 times the centre minus its in-bounds neighbours, clamped and boosted
+			auto emit = [&](int j, int sum) {
+				int hp = 9 * mid[j] - sum;
+				if (hp < 0) hp = 0;
+				else if (hp > 255) hp = 255;
+				out[j] = static_cast<uchar>(std::min(255, boost[hp] + mid[j]));
+			};
+			auto column = [&](int y) { return mid[y] + (up ? up[y] : 0) + (down ? down[y] : 0); };
+
+			// interleaved channels are walked as one row of samples, neighbours `cn` apart;
+			// the first and last pixel lack a neighbour on one side
+			int first = std::min(cn, samples), last = std::max(samples - cn, first);
+			for (int j = 0; j < first; j++) emit(j, column(j) + (j + cn < samples ? column(j + cn) : 0));
+			if (up && down) {
+				for (int j = first; j < last; j++) {
+					emit(j, up[j - cn] + up[j] + up[j + cn] + mid[j - cn] + mid[j] + mid[j + cn]
+						+ down[j - cn] + down[j] + down[j + cn]);
+				}
+			}
+			else {
+				for (int j = first; j < last; j++) emit(j, column(j - cn) + column(j) + column(j + cn));
+			}
+			for (int j = last; j < samples; j++) emit(j, column(j - cn) + column(j));
+		}
+	}, ROW_BAND);
+}
+
+// coefficients of the Young - van Vliet recursive Gaussian
+struct RecursiveCoeffs {
+	double B, b1, b2, b3; // y[n] = B x[n] + b1 y[n - 1] + b2 y[n - 2] + b3 y[n - 3]
+	double M[3][3];       // anti-causal state past the last sample, from the last 3 causal outputs
+};
+
+// fills `c.M` after Triggs and Sdika: for an input extended with its last value u, the anti-causal
+// outputs y[n], y[n + 1], y[n + 2] are u + M (w[n - 1] - u, w[n - 2] - u, w[n - 3] - u), where w is
+// the causal output; M is found by running both recursions past the border on each unit state
+static void borderMatrix(RecursiveCoeffs& c) {
+	for (int k = 0; k < 3; k++) {
+		double w1 = k == 0, w2 = k == 1, w3 = k == 2;
+		std::vector<double> tail;
+		while (tail.size() < 3 || fabs(w1) + fabs(w2) + fabs(w3) > 1e-15) {
+			double w = c.b1 * w1 + c.b2 * w2 + c.b3 * w3;
+			tail.push_back(w);
+			w3 = w2; w2 = w1; w1 = w;
+		}
+		double y1 = 0, y2 = 0, y3 = 0;
+		for (int t = static_cast<int>(tail.size()) - 1; t >= 0; t--) {
+			double y = c.B * tail[t] + c.b1 * y1 + c.b2 * y2 + c.b3 * y3;
+			if (t < 3) c.M[t][k] = y;
+			y3 = y2; y2 = y1; y1 = y;
 		}
 	}
-	result += image;
+}
+
+static RecursiveCoeffs recursiveCoeffs(double sigma) {
+	double q = (sigma >= 2.5) ? 0.98711 * sigma - 0.96330 : 3.97156 - 4.14554 * sqrt(1 - 0.26891 * sigma);
+	double b0 = 1.57825 + 2.44413 * q + 1.4281 * q * q + 0.422205 * q * q * q;
+	RecursiveCoeffs c;
+	c.b1 = (2.44413 * q + 2.85619 * q * q + 1.26661 * q * q * q) / b0;
+	c.b2 = -(1.4281 * q * q + 1.26661 * q * q * q) / b0;
+	c.b3 = 0.422205 * q * q * q / b0;
+	c.B = 1 - (c.b1 + c.b2 + c.b3);
+	borderMatrix(c);
+	return c;
+}
+
+// initial state (y[n], y[n + 1], y[n + 2]) of the anti-causal recursion of a line of `n` samples
+// whose input ends with `last`, from its causal outputs `w` (read `step` apart) and its first input
+template <class Line>
+static void borderState(const RecursiveCoeffs& c, const Line& w, int n, double first, double last, double* state) {
+	double v[3];
+	for (int k = 0; k < 3; k++) v[k] = ((n - 1 - k >= 0) ? w(n - 1 - k) : first) - last;
+	for (int t = 0; t < 3; t++) state[t] = last + c.M[t][0] * v[0] + c.M[t][1] * v[1] + c.M[t][2] * v[2];
+}
+
+// runs the causal and anti-causal recursions in-place over `n` samples, keeping the causal
+// output in the `n` doubles of `causal`
+// borders are extended with the edge values: the causal recursion starts in the steady state of
+// the first one, and the anti-causal one in the exact state for the last one
+static void recursiveLine(float* line, double* causal, int n, const RecursiveCoeffs& c) {
+	double first = line[0], last = line[n - 1];
+	double w1 = first, w2 = w1, w3 = w1;
+	for (int k = 0; k < n; k++) {
+		double w = c.B * line[k] + c.b1 * w1 + c.b2 * w2 + c.b3 * w3;
+		causal[k] = w;
+		w3 = w2; w2 = w1; w1 = w;
+	}
+	double state[3];
+	borderState(c, [&](int k) { return causal[k]; }, n, first, last, state);
+	double y1 = state[0], y2 = state[1], y3 = state[2];
+	for (int k = n - 1; k >= 0; k--) {
+		double y = c.B * causal[k] + c.b1 * y1 + c.b2 * y2 + c.b3 * y3;
+		line[k] = static_cast<float>(y);
+		y3 = y2; y2 = y1; y1 = y;
+	}
+}
+
+// derivative of order 1 (central difference) or 2 from the previous, current and next samples
+static inline float difference(float prev, float cur, float next, int order) {
+	return (order == 1) ? (next - prev) * 0.5f : next - 2 * cur + prev;
+}
+
+// performs recursive Gaussian filtering
+// rows are filtered in parallel, then columns in parallel blocks swept row by row so that
+// every access stays sequential in memory
+cv::Mat recursiveGaussian(const cv::Mat& image, double sigma, int dx, int dy) {
+	if (image.type() != CV_8UC1 && image.type() != CV_32FC1) {
+		throw std::runtime_error("recursiveGaussian takes CV_8UC1 or CV_32FC1 images!");
+	}
+	int rows = image.rows;
+	int cols = image.cols;
+	cv::Mat result(rows, cols, CV_32FC1);
+	bool smooth = sigma >= 0.5;
+	RecursiveCoeffs c = recursiveCoeffs(std::max(sigma, 0.5));
+
+	// horizontal pass
+	parallelFor(0, rows, [&](int rowBegin, int rowEnd) {
+		std::vector<float> line(cols);
+		std::vector<double> causal(cols);
+		for (int i = rowBegin; i < rowEnd; i++) {
+			for (int j = 0; j < cols; j++) {
+				line[j] = (image.depth() == CV_8U) ? image.at<uchar>(i, j) : image.at<float>(i, j);
+			}
+			if (smooth && cols > 1) recursiveLine(line.data(), causal.data(), cols, c);
+			float* out = result.ptr<float>(i);
+			for (int j = 0; j < cols; j++) {
+				out[j] = dx ? difference(line[std::max(j - 1, 0)], line[j], line[std::min(j + 1, cols - 1)], dx) : line[j];
+			}
+		}
+	}, ROW_BAND);
+
+	// vertical pass, over blocks of columns
+	const int COLUMN_BLOCK = 64;
+	if (smooth && rows > 1) {
+		parallelFor(0, cols, [&](int colBegin, int colEnd) {
+			int width = colEnd - colBegin;
+			std::vector<double> w1(width), w2(width), w3(width), first(width), last(width);
+			for (int j = 0; j < width; j++) {
+				first[j] = result.ptr<float>(0)[colBegin + j];
+				last[j] = result.ptr<float>(rows - 1)[colBegin + j];
+			}
+			auto sweep = [&](int begin, int end, int step) {
+				for (int i = begin; i != end + step; i += step) {
+					float* row = result.ptr<float>(i) + colBegin;
+					for (int j = 0; j < width; j++) {
+						double w = c.B * row[j] + c.b1 * w1[j] + c.b2 * w2[j] + c.b3 * w3[j];
+						row[j] = static_cast<float>(w);
+						w3[j] = w2[j]; w2[j] = w1[j]; w1[j] = w;
+					}
+				}
+			};
+			for (int j = 0; j < width; j++) w1[j] = w2[j] = w3[j] = first[j];
+			sweep(0, rows - 1, 1);
+			for (int j = 0; j < width; j++) {
+				double state[3];
+				borderState(c, [&](int i) { return result.ptr<float>(i)[colBegin + j]; }, rows, first[j], last[j], state);
+				w1[j] = state[0]; w2[j] = state[1]; w3[j] = state[2];
+			}
+			sweep(rows - 1, 0, -1);
+		}, COLUMN_BLOCK);
+	}
+	if (dy) {
+		cv::Mat smoothed = result.clone();
+		parallelFor(0, rows, [&](int rowBegin, int rowEnd) {
+			for (int i = rowBegin; i < rowEnd; i++) {
+				const float* prev = smoothed.ptr<float>(std::max(i - 1, 0));
+				const float* cur = smoothed.ptr<float>(i);
+				const float* next = smoothed.ptr<float>(std::min(i + 1, rows - 1));
+				float* out = result.ptr<float>(i);
+				for (int j = 0; j < cols; j++) out[j] = difference(prev[j], cur[j], next[j], dy);
+			}
+		}, ROW_BAND);
+	}
 	return result;
 }
@@ -1,141 +1,977 @@
 #include "freqfilt.h"
+#include "parallel.h"
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <new>
+#include <tuple>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+#include "fftlanes.h"
 
 const double EPS = 1e-8;
 
+// aligned matrix implementation
+
+template <class Element>
+void AlignedMatrix<Element>::Release::operator()(Element* p) const {
+    ::operator delete(p, std::align_val_t(ALIGNMENT));
+}
+
+// default constructor for AlignedMatrix
+template <class Element>
+AlignedMatrix<Element>::AlignedMatrix() : n(0), m(0), capacity(0), buffer(nullptr) {}
+
+template <class Element>
+AlignedMatrix<Element>::AlignedMatrix(int rows, int cols) : AlignedMatrix() {
+    reset(rows, cols);
+}
+
+template <class Element>
+AlignedMatrix<Element>::AlignedMatrix(const AlignedMatrix& other) : AlignedMatrix() {
+    *this = other;
+}
+
+template <class Element>
+AlignedMatrix<Element>::AlignedMatrix(AlignedMatrix&& other) noexcept : AlignedMatrix() {
+    swap(other);
+}
+
+template <class Element>
+AlignedMatrix<Element>& AlignedMatrix<Element>::operator=(const AlignedMatrix& other) {
+    if (this != &other) {
+        reset(other.n, other.m);
+        std::copy(other.data(), other.data() + static_cast<size_t>(n) * m, data());
+    }
+    return *this;
+}
+
+template <class Element>
+AlignedMatrix<Element>& AlignedMatrix<Element>::operator=(AlignedMatrix&& other) noexcept {
+    swap(other);
+    return *this;
+}
+
+template <class Element>
+void AlignedMatrix<Element>::reset(int rows, int cols) {
+    size_t count = static_cast<size_t>(rows) * cols;
+    if (count > capacity) {
+        Element* fresh = static_cast<Element*>(::operator new(count * sizeof(Element), std::align_val_t(ALIGNMENT)));
+        std::uninitialized_fill_n(fresh, count, Element(0));
+        buffer.reset(fresh);
+        capacity = count;
+    }
+    else {
+        std::fill(data(), data() + count, Element(0));
+    }
+    n = rows;
+    m = cols;
+}
+
+template <class Element>
+void AlignedMatrix<Element>::swap(AlignedMatrix& other) noexcept {
+    std::swap(n, other.n);
+    std::swap(m, other.m);
+    std::swap(capacity, other.capacity);
+    buffer.swap(other.buffer);
+}
+
+template class AlignedMatrix<cd>;
+template class AlignedMatrix<cf>;
+template class AlignedMatrix<double>;
+template class AlignedMatrix<float>;
+
+
 // FFT and IFFT implementation
 
-// performs FFT/IFFT over a sequence in-place 
-// `invert` should be true for IFFT, otherwise false
-void fft(std::vector<cd>& seq, bool invert) {
-	int n = seq.size();
+// radices of the mixed-radix transform, tried in this order; lengths with any other prime
+// factor go through Bluestein's algorithm
+static const int RADICES[] = { 4, 2, 3, 5, 7 };
+
+// columns gathered per batch of the column transforms (two cache lines of each row), and
+// side of the tiles of the transposition
+static const int COLUMN_BATCH = 8;
+static const int TRANSPOSE_TILE = 16;
+
+// elements per parallel task of the 2-D transforms and of the transposition, enough to
+// outweigh the scheduling cost
+static const int PARALLEL_GRAIN = 1 << 14;
+
+// constants of the radix-3, radix-5 and radix-7 butterflies
+static const double SIN_3 = sin(2 * PI / 3);
+static const double COS_5_1 = cos(2 * PI / 5), COS_5_2 = cos(4 * PI / 5);
+static const double SIN_5_1 = sin(2 * PI / 5), SIN_5_2 = sin(4 * PI / 5);
+static const double COS_7[3] = { cos(2 * PI / 7), cos(4 * PI / 7), cos(6 * PI / 7) };
+static const double SIN_7[3] = { sin(2 * PI / 7), sin(4 * PI / 7), sin(6 * PI / 7) };
+
+// true if `n` is a power of two
+static bool isPowerOfTwo(int n) {
+    return n > 0 && (n & (n - 1)) == 0;
+}
+
+// smallest power of two not below `n`
+static int nextPowerOfTwo(int n) {
+    int p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+// SSE2 lanes, part of every x86-64 CPU; the wider ones are compiled in fftavx2.cpp and
+// fftavx512.cpp, and picked at run time
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+namespace {
+
+template <class R>
+struct Sse2Complex;
+
+// 1 complex number at a time, in one register rather than two scalars
+template <>
+struct Sse2Complex<double> {
+    using Real = double;
+    using Complex = cd;
+    using T = __m128d;
+    static const int WIDTH = 1;
+    static T load(const cd* p) { return _mm_loadu_pd(reinterpret_cast<const double*>(p)); }
+    static void store(cd* p, T v) { _mm_storeu_pd(reinterpret_cast<double*>(p), v); }
+    static T add(T a, T b) { return _mm_add_pd(a, b); }
+    static T sub(T a, T b) { return _mm_sub_pd(a, b); }
+    static T mul(T v, const double* re, const double* im) {
+        T swapped = _mm_shuffle_pd(v, v, 1);
+        T cross = _mm_xor_pd(_mm_mul_pd(swapped, _mm_loadu_pd(im)), _mm_set_pd(0.0, -0.0));
+        return _mm_add_pd(_mm_mul_pd(v, _mm_loadu_pd(re)), cross);
+    }
+    template <bool Invert> static T rotate(T v) {
+        return _mm_xor_pd(_mm_shuffle_pd(v, v, 1), Invert ? _mm_set_pd(-0.0, 0.0) : _mm_set_pd(0.0, -0.0));
+    }
+};
+
+// 2 complex numbers at a time
+template <>
+struct Sse2Complex<float> {
+    using Real = float;
+    using Complex = cf;
+    using T = __m128;
+    static const int WIDTH = 2;
+    static T load(const cf* p) { return _mm_loadu_ps(reinterpret_cast<const float*>(p)); }
+    static void store(cf* p, T v) { _mm_storeu_ps(reinterpret_cast<float*>(p), v); }
+    static T add(T a, T b) { return _mm_add_ps(a, b); }
+    static T sub(T a, T b) { return _mm_sub_ps(a, b); }
+    static T mul(T v, const float* re, const float* im) {
+        T swapped = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+        T cross = _mm_xor_ps(_mm_mul_ps(swapped, _mm_loadu_ps(im)), _mm_set_ps(0.0f, -0.0f, 0.0f, -0.0f));
+        return _mm_add_ps(_mm_mul_ps(v, _mm_loadu_ps(re)), cross);
+    }
+    template <bool Invert> static T rotate(T v) {
+        T swapped = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+        return _mm_xor_ps(swapped, Invert ? _mm_set_ps(-0.0f, 0.0f, -0.0f, 0.0f) : _mm_set_ps(0.0f, -0.0f, 0.0f, -0.0f));
+    }
+};
+
+} // namespace
+#endif
+
+// CPU features, read once; GCC and Clang check the operating system support of the wide
+// registers themselves, MSVC reads it from XCR0
+static bool cpuSupports(FftIsa isa) {
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    switch (isa) {
+    case FFT_SSE2: return __builtin_cpu_supports("sse2");
+    case FFT_AVX2: return __builtin_cpu_supports("avx2");
+    case FFT_AVX512: return __builtin_cpu_supports("avx512f");
+    default: return true;
+    }
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 1);
+    bool sse2 = info[3] & (1 << 26), osxsave = info[2] & (1 << 27);
+    unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    __cpuidex(info, 7, 0);
+    switch (isa) {
+    case FFT_SSE2: return sse2;
+    case FFT_AVX2: return (info[1] & (1 << 5)) && (xcr0 & 0x6) == 0x6;
+    case FFT_AVX512: return (info[1] & (1 << 16)) && (xcr0 & 0xE6) == 0xE6;
+    default: return true;
+    }
+#else
+    return isa == FFT_SCALAR;
+#endif
+}
+
+// kernels of `isa` in precision R, or nullptr if they are not compiled in
+template <class R>
+static const FftKernels<R>* kernelsOf(FftIsa isa) {
+    static const FftKernels<R> scalar = FFT_KERNELS(ScalarComplex<R>);
+    switch (isa) {
+    case FFT_SCALAR: return &scalar;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    case FFT_SSE2: {
+        static const FftKernels<R> sse2 = FFT_KERNELS(Sse2Complex<R>);
+        return &sse2;
+    }
+#endif
+    case FFT_AVX2: return avx2Kernels<R>();
+    case FFT_AVX512: return avx512Kernels<R>();
+    default: return nullptr;
+    }
+}
+
+// tells whether the FFT kernels of an instruction set are compiled in and run on this CPU
+bool fftIsaSupported(FftIsa isa) {
+    static const bool supported[] = {
+        true, kernelsOf<double>(FFT_SSE2) && cpuSupports(FFT_SSE2), kernelsOf<double>(FFT_AVX2) && cpuSupports(FFT_AVX2),
+        kernelsOf<double>(FFT_AVX512) && cpuSupports(FFT_AVX512)
+    };
+    return isa >= FFT_SCALAR && isa <= FFT_AVX512 && supported[isa];
+}
+
+// the widest supported instruction set
+FftIsa fftBestIsa() {
+    static const FftIsa best = fftIsaSupported(FFT_AVX512) ? FFT_AVX512 : fftIsaSupported(FFT_AVX2) ? FFT_AVX2
+                             : fftIsaSupported(FFT_SSE2) ? FFT_SSE2 : FFT_SCALAR;
+    return best;
+}
+
+// scratch sequence of at least `n` elements, one set per thread and precision
+// slot 0 holds the input of the mixed-radix transform, slot 1 the Bluestein convolution
+// (or a gathered column when slot 0 is busy) and slot 2 the packed real sequence
+template <class T = double>
+static std::complex<T>* scratchFor(int n, int which = 0) {
+    thread_local std::vector<std::complex<T>> scratch[3];
+    if (static_cast<int>(scratch[which].size()) < n) scratch[which].resize(n);
+    return scratch[which].data();
+}
 
-    // applying bit-reversal permutation to perform in-place FFT/IFFT
-    for (int i = 1, j = 0; i < n; i++) {
-        int bit = n >> 1;
-        for (; j & bit; bit >>= 1)
+// builds the tables of a transform of length `n` in the given direction, running the kernels
+// of instruction set `isa`; every twiddle is computed directly from its angle, so none
+// accumulates rounding errors
+template <class T>
+BasicFftPlan<T>::BasicFftPlan(int n, bool invert, FftIsa isa) : n(n), invert(invert), kind(RADIX_2), isa(isa), m(0) {
+    if (!fftIsaSupported(isa)) throw std::runtime_error("Unsupported instruction set for the FFT!");
+    lanes = kernelsOf<T>(isa);
+    auto root = [](long long k, long long period, bool conjugate) {
+        double angle = 2 * PI * static_cast<double>(k % period) / period * (conjugate ? -1 : 1);
+        return cd(cos(angle), sin(angle));
+    };
+    if (n % 2 == 0) {
+        realTwiddles.resize(n / 2 + 1);
+        for (int k = 0; k <= n / 2; k++) realTwiddles[k] = Complex(root(k, n, invert));
+    }
+    if (n <= 1) return;
+
+    if (isPowerOfTwo(n)) {
+        // pairs of indices exchanged by the bit-reversal permutation
+        for (int i = 1, j = 0; i < n; i++) {
+            int bit = n >> 1;
+            for (; j & bit; bit >>= 1)
+                j ^= bit;
             j ^= bit;
-        j ^= bit;
-        if (i < j) std::swap(seq[i], seq[j]);
-    }
-
-    for (int len = 2; len <= n; len <<= 1) {
-        double ang = 2 * PI / len * (invert ? -1 : 1);
-        cd wlen(cos(ang), sin(ang));
-        for (int i = 0; i < n; i += len) {
-            cd w(1);
-            for (int j = 0; j < len / 2; j++) {
-                cd u = seq[i + j], v = seq[i + j + len / 2] * w;
-                seq[i + j] = u + v;
-                seq[i + j + len / 2] = u - v;
-                w *= wlen;
+            if (i < j) {
+                swaps.push_back(i);
+                swaps.push_back(j);
             }
         }
+        // the pass merging blocks of `half` elements twiddles by exp(+-2 pi i j / (2 half)), j < half;
+        // the tables of the passes follow each other, the one of `half` starting at half - 1
+        for (int half = 1; half < n; half <<= 1) {
+            for (int j = 0; j < half; j++) addPassTwiddle(root(static_cast<long long>(j) * (n / (2 * half)), n, invert));
+        }
+        return;
+    }
+
+    int rest = n;
+    for (int radix : RADICES) {
+        while (rest % radix == 0) {
+            factors.push_back(radix);
+            rest /= radix;
+        }
+    }
+    if (rest == 1) {
+        kind = MIXED_RADIX;
+        twiddles.resize(n);
+        for (int k = 0; k < n; k++) twiddles[k] = Complex(root(k, n, invert));
+        // contiguous tables of the radix-2 and radix-4 levels, where butterfly k of a level of
+        // `block` elements per block twiddles input q by exp(+-2 pi i q k stride / n)
+        int stride = 1;
+        for (int radix : factors) {
+            int block = n / stride / radix;
+            levelOffsets.push_back(static_cast<int>(passRe.size()));
+            if (radix == 2 || radix == 4) {
+                for (int q = 1; q < radix; q++) {
+                    for (int k = 0; k < block; k++) addPassTwiddle(root(static_cast<long long>(q) * k * stride, n, invert));
+                }
+            }
+            stride *= radix;
+        }
+        return;
+    }
+
+    // Bluestein's algorithm, with the chirp of the forward transform in both directions;
+    // exponents are taken modulo 2n, so that they stay exact for large k
+    // the spectrum of the chirp comes from the double transform whatever the precision
+    kind = BLUESTEIN;
+    m = nextPowerOfTwo(2 * n - 1);
+    forward = get(m, false, isa);
+    backward = get(m, true, isa);
+    chirp.resize(n);
+    std::vector<cd> spectrum(m, cd(0));
+    for (long long k = 0; k < n; k++) {
+        cd value = root(k * k, 2LL * n, false);
+        chirp[k] = Complex(value);
+        spectrum[k] = std::conj(value);
+        if (k) spectrum[m - k] = std::conj(value);
+    }
+    FftPlan::get(m, false)->execute(spectrum.data());
+    chirpSpectrum.assign(spectrum.begin(), spectrum.end());
+}
+
+// plan of the transform of length `n` in the given direction, built on first use and then
+// shared by every caller; plans are built outside the lock, since Bluestein plans need others
+template <class T>
+std::shared_ptr<const BasicFftPlan<T>> BasicFftPlan<T>::get(int n, bool invert, FftIsa isa) {
+    static std::mutex mutex;
+    static std::map<std::tuple<int, bool, FftIsa>, std::shared_ptr<const BasicFftPlan>> plans;
+    std::tuple<int, bool, FftIsa> key(n, invert, isa);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = plans.find(key);
+        if (found != plans.end()) return found->second;
+    }
+    auto plan = std::make_shared<const BasicFftPlan>(n, invert, isa);
+    std::lock_guard<std::mutex> lock(mutex);
+    return plans.emplace(key, plan).first->second;
+}
+
+// appends a twiddle to the tables of the vectorized passes, each part stored twice
+template <class T>
+void BasicFftPlan<T>::addPassTwiddle(const cd& w) {
+    passRe.insert(passRe.end(), 2, static_cast<T>(w.real()));
+    passIm.insert(passIm.end(), 2, static_cast<T>(w.imag()));
+}
+
+// in-place radix-2 transform: bit-reversal permutation, then the log2(n) passes of butterflies
+// two at a time as radix-4 passes (after a first lone pass if log2(n) is odd), on the widest
+// lanes that fit the blocks of the pass
+template <class T>
+template <bool Invert>
+void BasicFftPlan<T>::radix2(Complex* seq) const {
+    for (size_t p = 0; p < swaps.size(); p += 2) std::swap(seq[swaps[p]], seq[swaps[p + 1]]);
+    int half = 1;
+    int passes = 0;
+    while ((1 << passes) < n) passes++;
+    if (passes % 2) {
+        for (int i = 0; i < n; i += 2) {
+            Complex u = seq[i], v = seq[i + 1];
+            seq[i] = u + v;
+            seq[i + 1] = u - v;
+        }
+        half = 2;
+    }
+    for (; half < n; half <<= 2) {
+        const T* re1 = passRe.data() + 2 * (half - 1);
+        const T* im1 = passIm.data() + 2 * (half - 1);
+        const T* re2 = passRe.data() + 2 * (2 * half - 1);
+        const T* im2 = passIm.data() + 2 * (2 * half - 1);
+        if (half >= lanes->width) lanes->radix4Pass[Invert](seq, n, half, re1, im1, re2, im2);
+        else radix4Pass<Invert, ScalarComplex<T>>(seq, n, half, re1, im1, re2, im2);
+    }
+}
+
+/**
+* butterflies merging `Radix` (3, 5 or 7) transformed blocks of `m` elements of `out`; the
+* input q of butterfly k is twiddled by exp(+-2 pi i q k stride / n)
+* inputs q and Radix - q are paired into their sum and difference, so that outputs u and
+* Radix - u share the products by the cosines and sines of 2 pi u q / Radix
+*/
+template <class T>
+template <bool Invert, int Radix>
+void BasicFftPlan<T>::butterflies(Complex* out, int m, int stride) const {
+    const T sin3 = static_cast<T>(SIN_3), half = static_cast<T>(0.5);
+    const T cos51 = static_cast<T>(COS_5_1), cos52 = static_cast<T>(COS_5_2);
+    const T sin51 = static_cast<T>(SIN_5_1), sin52 = static_cast<T>(SIN_5_2);
+    const T cos71 = static_cast<T>(COS_7[0]), cos72 = static_cast<T>(COS_7[1]), cos73 = static_cast<T>(COS_7[2]);
+    const T sin71 = static_cast<T>(SIN_7[0]), sin72 = static_cast<T>(SIN_7[1]), sin73 = static_cast<T>(SIN_7[2]);
+    for (int k = 0; k < m; k++) {
+        Complex a0 = out[k];
+        if (Radix == 3) {
+            Complex a1 = mul(out[k + m], twiddles[k * stride]), a2 = mul(out[k + 2 * m], twiddles[2 * k * stride]);
+            Complex sum = a1 + a2, difference = sin3 * rotate<Invert>(a1 - a2);
+            Complex centre = a0 - half * sum;
+            out[k] = a0 + sum;
+            out[k + m] = centre + difference;
+            out[k + 2 * m] = centre - difference;
+        }
+        else if (Radix == 5) {
+            Complex a1 = mul(out[k + m], twiddles[k * stride]), a2 = mul(out[k + 2 * m], twiddles[2 * k * stride]);
+            Complex a3 = mul(out[k + 3 * m], twiddles[3 * k * stride]), a4 = mul(out[k + 4 * m], twiddles[4 * k * stride]);
+            Complex t1 = a1 + a4, t2 = a2 + a3, d1 = a1 - a4, d2 = a2 - a3;
+            Complex r1 = a0 + cos51 * t1 + cos52 * t2, i1 = rotate<Invert>(sin51 * d1 + sin52 * d2);
+            Complex r2 = a0 + cos52 * t1 + cos51 * t2, i2 = rotate<Invert>(sin52 * d1 - sin51 * d2);
+            out[k] = a0 + t1 + t2;
+            out[k + m] = r1 + i1;
+            out[k + 2 * m] = r2 + i2;
+            out[k + 3 * m] = r2 - i2;
+            out[k + 4 * m] = r1 - i1;
+        }
+        else {
+            Complex a1 = mul(out[k + m], twiddles[k * stride]), a2 = mul(out[k + 2 * m], twiddles[2 * k * stride]);
+            Complex a3 = mul(out[k + 3 * m], twiddles[3 * k * stride]), a4 = mul(out[k + 4 * m], twiddles[4 * k * stride]);
+            Complex a5 = mul(out[k + 5 * m], twiddles[5 * k * stride]), a6 = mul(out[k + 6 * m], twiddles[6 * k * stride]);
+            Complex t1 = a1 + a6, t2 = a2 + a5, t3 = a3 + a4, d1 = a1 - a6, d2 = a2 - a5, d3 = a3 - a4;
+            Complex r1 = a0 + cos71 * t1 + cos72 * t2 + cos73 * t3, i1 = rotate<Invert>(sin71 * d1 + sin72 * d2 + sin73 * d3);
+            Complex r2 = a0 + cos72 * t1 + cos73 * t2 + cos71 * t3, i2 = rotate<Invert>(sin72 * d1 - sin73 * d2 - sin71 * d3);
+            Complex r3 = a0 + cos73 * t1 + cos71 * t2 + cos72 * t3, i3 = rotate<Invert>(sin73 * d1 - sin71 * d2 + sin72 * d3);
+            out[k] = a0 + t1 + t2 + t3;
+            out[k + m] = r1 + i1;
+            out[k + 2 * m] = r2 + i2;
+            out[k + 3 * m] = r3 + i3;
+            out[k + 4 * m] = r3 - i3;
+            out[k + 5 * m] = r2 - i2;
+            out[k + 6 * m] = r1 - i1;
+        }
+    }
+}
+
+/**
+* decimation-in-time step of the mixed-radix transform (as in KISS FFT)
+* transforms the `length` elements of `in` taken every `stride` into `out`: the interleaved
+* subsequences of the first radix are transformed recursively into consecutive blocks of
+* `out`, then merged with one butterfly per output index of a block
+*/
+template <class T>
+template <bool Invert>
+void BasicFftPlan<T>::mixedRadix(Complex* out, const Complex* in, int length, int stride, const int* radices) const {
+    int radix = radices[0];
+    int block = length / radix;
+    if (block == 1) {
+        for (int q = 0; q < radix; q++) out[q] = in[q * stride];
+    }
+    else {
+        for (int q = 0; q < radix; q++) mixedRadix<Invert>(out + q * block, in + q * stride, block, stride * radix, radices + 1);
+    }
+    int offset = levelOffsets[radices - factors.data()];
+    switch (radix) {
+    case 2: lanes->radix2Butterflies[Invert](out, block, passRe.data() + offset, passIm.data() + offset); break;
+    case 3: butterflies<Invert, 3>(out, block, stride); break;
+    case 4: lanes->radix4Butterflies[Invert](out, block, passRe.data() + offset, passIm.data() + offset); break;
+    case 5: butterflies<Invert, 5>(out, block, stride); break;
+    default: butterflies<Invert, 7>(out, block, stride);
+    }
+}
+
+// Bluestein's algorithm: the transform as a convolution with a chirp, done by power-of-two FFTs
+// the inverse is the conjugate of the forward transform of the conjugate
+template <class T>
+void BasicFftPlan<T>::bluestein(Complex* seq) const {
+    Complex* work = scratchFor<T>(m, 1);
+    for (int k = 0; k < n; k++) work[k] = mul(invert ? std::conj(seq[k]) : seq[k], chirp[k]);
+    std::fill(work + n, work + m, Complex(0));
+    forward->execute(work);
+    for (int k = 0; k < m; k++) work[k] = mul(work[k], chirpSpectrum[k]);
+    backward->execute(work);
+    for (int k = 0; k < n; k++) {
+        Complex value = mul(work[k], chirp[k]);
+        seq[k] = invert ? std::conj(value) : value;
+    }
+}
+
+// performs the planned FFT/IFFT over `n` contiguous elements in-place
+template <class T>
+void BasicFftPlan<T>::execute(Complex* seq) const {
+    if (n <= 1) return;
+    if (kind == RADIX_2) {
+        if (invert) radix2<true>(seq);
+        else radix2<false>(seq);
+    }
+    else if (kind == BLUESTEIN) {
+        bluestein(seq);
+    }
+    else {
+        Complex* in = scratchFor<T>(n);
+        std::copy(seq, seq + n, in);
+        if (invert) mixedRadix<true>(seq, in, n, 1, factors.data());
+        else mixedRadix<false>(seq, in, n, 1, factors.data());
     }
     if (invert) {
-        for (cd& x : seq)
-            x /= n;
+        for (int i = 0; i < n; i++)
+            seq[i] /= static_cast<T>(n);
     }
 }
 
-// performs FFT/IFFT over a matrix
+template <class T>
+void BasicFftPlan<T>::execute(std::vector<Complex>& seq) const {
+    assert(static_cast<int>(seq.size()) == n);
+    execute(seq.data());
+}
+
+template class BasicFftPlan<double>;
+template class BasicFftPlan<float>;
+
+// performs FFT/IFFT over `n` contiguous elements in-place
+template <class T>
+static void fft(std::complex<T>* seq, int n, bool invert) {
+    if (n > 1) BasicFftPlan<T>::get(n, invert)->execute(seq);
+}
+
+// performs FFT/IFFT over a sequence of any length in-place, with the plan of its length
+// powers of two use the radix-2 transform, lengths whose prime factors are all 2, 3, 5 or 7
+// the mixed-radix one, and other lengths Bluestein's algorithm
+// `invert` should be true for IFFT, otherwise false
+void fft(std::vector<cd>& seq, bool invert) {
+    fft(seq.data(), static_cast<int>(seq.size()), invert);
+}
+
+void fft(std::vector<cf>& seq, bool invert) {
+    fft(seq.data(), static_cast<int>(seq.size()), invert);
+}
+
+// performs FFT/IFFT over the first `cols` columns of a matrix, gathered COLUMN_BATCH at a time
+// into contiguous scratch, so that every row is read a whole cache line at a time rather than
+// transposing the matrix (Bluestein's algorithm works in the second scratch, so the batch then
+// takes the first)
+// batches run in parallel, each on the scratch of its thread
+template <class T>
+static void fftColumns(BasicCMatrix<T>& mat, int cols, bool invert) {
+    int n = mat.rows();
+    auto plan = BasicFftPlan<T>::get(n, invert);
+    int batches = (cols + COLUMN_BATCH - 1) / COLUMN_BATCH;
+    parallelFor(0, batches, [&](int batchBegin, int batchEnd) {
+        std::complex<T>* batch = scratchFor<T>(COLUMN_BATCH * n, plan->usesConvolution() ? 0 : 1);
+        for (int j0 = batchBegin * COLUMN_BATCH; j0 < std::min(batchEnd * COLUMN_BATCH, cols); j0 += COLUMN_BATCH) {
+            int width = std::min(COLUMN_BATCH, cols - j0);
+            for (int i = 0; i < n; i++) {
+                const std::complex<T>* row = mat[i] + j0;
+                for (int b = 0; b < width; b++) batch[b * n + i] = row[b];
+            }
+            for (int b = 0; b < width; b++) plan->execute(batch + b * n);
+            for (int i = 0; i < n; i++) {
+                std::complex<T>* row = mat[i] + j0;
+                for (int b = 0; b < width; b++) row[b] = batch[b * n + i];
+            }
+        }
+    }, std::max(1, PARALLEL_GRAIN / (COLUMN_BATCH * n)));
+}
+
+// performs FFT/IFFT over a rows x cols matrix, with one plan for the rows and one for the columns
+// both passes run on the thread pool; every row and column is transformed by one thread with
+// the same plan, so the result does not depend on the number of threads
 // `invert` should be true for IFFT, otherwise false
-void fft(std::vector<std::vector<cd>>& mat, bool invert) {
+template <class T>
+void fft(BasicCMatrix<T>& mat, bool invert) {
+    if (mat.empty()) return;
+    int n = mat.rows(), m = mat.cols();
+
     // applying operation over rows
-    for (auto& row : mat) fft(row, invert);
-    transpose(mat);
+    auto plan = BasicFftPlan<T>::get(m, invert);
+    parallelFor(0, n, [&](int rowBegin, int rowEnd) {
+        for (int i = rowBegin; i < rowEnd; i++) plan->execute(mat[i]);
+    }, std::max(1, PARALLEL_GRAIN / m));
+
+    fftColumns(mat, m, invert);
+}
 
-    // applying operation over rows of transposed matrix
-    // which is equivalent to applying over columns of the original matrix
-    for (auto& row : mat) fft(row, invert);
+template void fft(CMatrix&, bool);
+template void fft(CMatrixF&, bool);
 
-    // copying the matrix back
-    transpose(mat);
+/**
+* transforms the `n` real samples of `in` into the first n / 2 + 1 coefficients of their
+* spectrum in `out`; the others are their conjugates, X[n - k] = conj(X[k])
+* even lengths pack the samples as z[j] = x[2j] + i x[2j + 1] and run one complex transform
+* of half the length, from which the transforms E and O of the even and odd samples are
+* split as E[k] = (Z[k] + conj(Z[-k])) / 2 and O[k] = (Z[k] - conj(Z[-k])) / 2i, giving
+* X[k] = E[k] + exp(2 pi i k / n) O[k]
+*/
+template <class T>
+static void rfft(const T* in, std::complex<T>* out, int n) {
+    using Complex = std::complex<T>;
+    if (n % 2) {
+        Complex* full = scratchFor<T>(n, 2);
+        for (int j = 0; j < n; j++) full[j] = in[j];
+        fft(full, n, false);
+        std::copy(full, full + n / 2 + 1, out);
+        return;
+    }
+    int h = n / 2;
+    Complex* z = scratchFor<T>(h, 2);
+    for (int j = 0; j < h; j++) z[j] = Complex(in[2 * j], in[2 * j + 1]);
+    fft(z, h, false);
+    const std::vector<Complex>& w = BasicFftPlan<T>::get(n, false)->halfTwiddles();
+    const T half = static_cast<T>(0.5);
+    for (int k = 0; k <= h; k++) {
+        Complex zk = z[k % h], zc = std::conj(z[(h - k) % h]);
+        Complex even = half * (zk + zc), odd = Complex(0, -half) * (zk - zc);
+        out[k] = even + mul(w[k], odd);
+    }
 }
 
-// shifts the spectrum
-void fftshift(std::vector<std::vector<cd>>& mat) {
-    int n = mat.size();
-    int offset = n / 2;
-    for (int i = 0; i < offset; i++) {
-        for (int j = 0; j < offset; j++) {
-            std::swap(mat[i][j], mat[i + offset][j + offset]);
+// rebuilds the `n` real samples `out` from the first n / 2 + 1 coefficients of their spectrum,
+// undoing the split of rfft before one complex inverse transform of half the length
+template <class T>
+static void irfft(const std::complex<T>* in, T* out, int n) {
+    using Complex = std::complex<T>;
+    if (n % 2) {
+        Complex* full = scratchFor<T>(n, 2);
+        for (int k = 0; k <= n / 2; k++) {
+            full[k] = in[k];
+            if (k) full[n - k] = std::conj(in[k]);
+        }
+        fft(full, n, true);
+        for (int j = 0; j < n; j++) out[j] = full[j].real();
+        return;
+    }
+    int h = n / 2;
+    Complex* z = scratchFor<T>(h, 2);
+    const std::vector<Complex>& w = BasicFftPlan<T>::get(n, true)->halfTwiddles();
+    const T half = static_cast<T>(0.5);
+    for (int k = 0; k < h; k++) {
+        Complex xk = in[k], xc = std::conj(in[h - k]);
+        Complex even = half * (xk + xc), odd = mul(half * (xk - xc), w[k]);
+        z[k] = even + Complex(-odd.imag(), odd.real());
+    }
+    fft(z, h, true);
+    for (int j = 0; j < h; j++) {
+        out[2 * j] = z[j].real();
+        out[2 * j + 1] = z[j].imag();
+    }
+}
+
+// transforms a real sequence into its n / 2 + 1 non-redundant coefficients
+template <class T>
+void rfft(const std::vector<T>& seq, std::vector<std::complex<T>>& half) {
+    int n = seq.size();
+    half.resize(n / 2 + 1);
+    if (n) rfft(seq.data(), half.data(), n);
+}
+
+template void rfft(const std::vector<double>&, std::vector<cd>&);
+template void rfft(const std::vector<float>&, std::vector<cf>&);
+
+// rebuilds a real sequence from its non-redundant coefficients; the size of `seq` gives the
+// length, which the coefficients alone do not tell apart between 2k and 2k + 1
+template <class T>
+void irfft(const std::vector<std::complex<T>>& half, std::vector<T>& seq) {
+    int n = seq.size();
+    if (n) irfft(half.data(), seq.data(), n);
+}
+
+template void irfft(const std::vector<cd>&, std::vector<double>&);
+template void irfft(const std::vector<cf>&, std::vector<float>&);
+
+// performs FFT over a real rows x cols matrix, keeping the rows x (cols / 2 + 1) half spectrum:
+// real transforms along the rows, then complex ones along the remaining columns
+template <class T>
+void rfft(const BasicRMatrix<T>& mat, BasicCMatrix<T>& half) {
+    int n = mat.rows();
+    int m = mat.cols();
+    half.reset(n, m / 2 + 1);
+    if (n == 0 || m == 0) return;
+    parallelFor(0, n, [&](int rowBegin, int rowEnd) {
+        for (int i = rowBegin; i < rowEnd; i++) rfft(mat[i], half[i], m);
+    }, std::max(1, PARALLEL_GRAIN / m));
+    fftColumns(half, m / 2 + 1, false);
+}
+
+template void rfft(const RMatrix&, CMatrix&);
+template void rfft(const RMatrixF&, CMatrixF&);
+
+// performs IFFT of a rows x (cols / 2 + 1) half spectrum into a real rows x cols matrix
+// `half` is overwritten by the intermediate column transforms
+template <class T>
+void irfft(BasicCMatrix<T>& half, BasicRMatrix<T>& mat, int cols) {
+    int n = half.rows();
+    mat.reset(n, cols);
+    if (n == 0 || cols == 0) return;
+    fftColumns(half, cols / 2 + 1, true);
+    parallelFor(0, n, [&](int rowBegin, int rowEnd) {
+        for (int i = rowBegin; i < rowEnd; i++) irfft(half[i], mat[i], cols);
+    }, std::max(1, PARALLEL_GRAIN / cols));
+}
+
+template void irfft(CMatrix&, RMatrix&, int);
+template void irfft(CMatrixF&, RMatrixF&, int);
+
+// rebuilds the full rows x cols spectrum from its half, for display
+template <class T>
+BasicCMatrix<T> fullSpectrum(const BasicCMatrix<T>& half, int cols) {
+    int n = half.rows();
+    BasicCMatrix<T> res(n, cols);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < cols; j++) {
+            res[i][j] = (j <= cols / 2) ? half[i][j] : std::conj(half[(n - i) % n][cols - j]);
+        }
+    }
+    return res;
+}
+
+template CMatrix fullSpectrum(const CMatrix&, int);
+template CMatrixF fullSpectrum(const CMatrixF&, int);
+
+// benchmark table of fftCost, in nanoseconds, measured single-threaded in double precision
+// over the lengths up to 8192 with no prime factor above 7, which it fits to within 8% on average
+static const double COST_RADIX_2_LEVEL = 0.51; // per element and level of the radix-2 transform
+static const double COST_CALL = 9.1;           // per recursive call of the mixed-radix transform
+static const double COST_PASS[8] = { 0, 0, 0.73, 1.81, 1.33, 2.40, 0, 2.77 }; // per element and pass, by radix
+static const double COST_2D_ELEMENT = 5;       // per element of a 2-D transform, gathering the columns
+
+// estimated time of a transform of length `n`, in nanoseconds; Bluestein's algorithm is
+// counted as its two power-of-two transforms
+double fftCost(int n) {
+    if (n <= 1) return 0;
+    if (isPowerOfTwo(n)) return COST_RADIX_2_LEVEL * n * log2(n);
+    // the radices in the order the plans take them; the step of every radix runs once per
+    // subsequence left by the radices before it
+    double cost = 0, calls = 1;
+    int rest = n;
+    for (int radix : RADICES) {
+        for (; rest % radix == 0; rest /= radix) {
+            cost += COST_PASS[radix] * n + COST_CALL * calls;
+            calls *= radix;
         }
     }
-    for (int i = offset; i < n; i++) {
-        for (int j = 0; j < offset; j++) {
-            std::swap(mat[i][j], mat[i - offset][j + offset]);
+    return rest == 1 ? cost : 2 * fftCost(nextPowerOfTwo(2 * n - 1));
+}
+
+// calls `f` with every length not below `n` worth padding it to: the next power of two, and
+// the shorter lengths that the mixed-radix transform handles, the shortest of every odd part
+// 3^a 5^b 7^c; nothing is allocated, so that conv can pick its padding on every call
+template <class F>
+static void forEachFftSize(int n, const F& f) {
+    n = std::max(n, 1);
+    int limit = nextPowerOfTwo(n);
+    f(limit);
+    for (long long odd7 = 1; odd7 <= limit; odd7 *= 7) {
+        for (long long odd5 = odd7; odd5 <= limit; odd5 *= 5) {
+            for (long long odd = odd5; odd <= limit; odd *= 3) {
+                long long size = odd;
+                while (size < n) size *= 2;
+                if (size < limit) f(static_cast<int>(size));
+            }
         }
     }
 }
 
+// cheapest length not below `n` by fftCost, the shortest one on ties
+int fftSize(int n) {
+    int best = 0;
+    double bestCost = 0;
+    forEachFftSize(n, [&](int size) {
+        double cost = fftCost(size);
+        if (!best || cost < bestCost || (cost == bestCost && size < best)) {
+            best = size;
+            bestCost = cost;
+        }
+    });
+    return best;
+}
+
+// estimated time of a rows x cols transform, in nanoseconds: a transform of every column
+// and of every row, and the gathering of the columns into contiguous batches
+double fftCost(int rows, int cols) {
+    return cols * fftCost(rows) + rows * fftCost(cols) + COST_2D_ELEMENT * rows * cols;
+}
+
+// cheapest padded shape not below rows x cols by the 2-D fftCost; padding one side also adds
+// transforms along the other, so the sides are picked together rather than one at a time
+std::pair<int, int> fftSize(int rows, int cols) {
+    std::pair<int, int> best(0, 0);
+    double bestCost = 0;
+    forEachFftSize(rows, [&](int n) {
+        forEachFftSize(cols, [&](int m) {
+            double cost = fftCost(n, m);
+            if (!best.first || cost < bestCost) {
+                best = { n, m };
+                bestCost = cost;
+            }
+        });
+    });
+    return best;
+}
+
+// shifts the spectrum, moving the zero frequency to (rows / 2, cols / 2)
+// the rows are contiguous, so rotating the whole buffer by whole rows moves them all at once
+template <class T>
+void fftshift(BasicCMatrix<T>& mat) {
+    if (mat.empty()) return;
+    int n = mat.rows(), m = mat.cols();
+    std::complex<T>* begin = mat.data();
+    std::rotate(begin, begin + static_cast<size_t>(n - n / 2) * m, begin + static_cast<size_t>(n) * m);
+    for (int i = 0; i < n; i++) std::rotate(mat[i], mat[i] + (m - m / 2), mat[i] + m);
+}
+
+template void fftshift(CMatrix&);
+template void fftshift(CMatrixF&);
 
 // filter implementation
 
-// ideal filter 
-void ideal(std::vector<std::vector<cd>>& filter, double d, int order, bool high) {
-    int n = filter.size();
-    d *= d;
-    for (int i = 0; i < n; i++) {
-        for (int j = 0; j < n; j++) {
-            double dist = (i - n / 2) * (i - n / 2) + (j - n / 2) * (j - n / 2);
-            double val = (dist < d) ? 1 : 0;
-            if (high) val = 1.0 - val;
-            filter[i][j] = cd(val, val);
+// number of masks FilterMask::get keeps, enough for the settings a slider goes back and forth over
+const size_t MASK_CACHE_SIZE = 32;
+
+// gain at squared distance `dist` from the centre, for a squared cutoff `d`
+static double maskGain(MaskType type, double dist, double d, int order) {
+    switch (type) {
+    case MASK_IDEAL:
+        return (dist < d) ? 1 : 0;
+    case MASK_GAUSSIAN:
+        return exp(-dist / std::max(d, EPS) * 2);
+    default:
+        return 1.0 / (1.0 + pow(dist / std::max(d, EPS), order));
+    }
+}
+
+// evaluates the gains of the quadrant di <= rows / 2, dj <= cols / 2 of distances from the
+// centre, then reads every element from it at (|i - rows / 2|, |j - cols / 2|)
+FilterMask::FilterMask(MaskType type, int rows, int cols, double cutoff, int order, bool high)
+    : rows(rows), cols(cols), gains(static_cast<size_t>(rows) * cols) {
+    int qn = rows / 2 + 1;
+    int qm = cols / 2 + 1;
+    double d = cutoff * cutoff;
+    std::vector<double> quadrant(static_cast<size_t>(qn) * qm);
+    for (int di = 0; di < qn; di++) {
+        for (int dj = 0; dj < qm; dj++) {
+            double val = maskGain(type, di * di + dj * dj, d, order);
+            quadrant[static_cast<size_t>(di) * qm + dj] = high ? 1.0 - val : val;
         }
     }
+    for (int i = 0; i < rows; i++) {
+        const double* source = quadrant.data() + static_cast<size_t>(std::abs(i - rows / 2)) * qm;
+        double* row = gains.data() + static_cast<size_t>(i) * cols;
+        for (int j = 0; j < cols; j++) row[j] = source[std::abs(j - cols / 2)];
+    }
 }
 
-// gaussian filter
-void gaussian(std::vector<std::vector<cd>>& filter, double d, int order, bool high) {
-    int n = filter.size();
-    d *= d; d = std::max(d, EPS);
-    for (int i = 0; i < n; i++) {
-        for (int j = 0; j < n; j++) {
-            double dist = (i - n / 2) * (i - n / 2) + (j - n / 2) * (j - n / 2);
-            double val = exp(-dist / d * 2);
-            if (high) val = 1.0 - val;
-            filter[i][j] = cd(val, val);
+// mask of the given parameters, built on first use and then shared by every caller until
+// MASK_CACHE_SIZE newer masks have been built; the order only matters to butterworth
+std::shared_ptr<const FilterMask> FilterMask::get(MaskType type, int rows, int cols, double cutoff,
+                                                  int order, bool high) {
+    using Key = std::tuple<int, int, int, double, int, bool>;
+    static std::mutex mutex;
+    static std::map<Key, std::shared_ptr<const FilterMask>> masks;
+    static std::deque<Key> built; // keys of `masks`, oldest first
+    if (type != MASK_BUTTERWORTH) order = 1;
+    Key key(type, rows, cols, cutoff, order, high);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = masks.find(key);
+        if (found != masks.end()) return found->second;
+    }
+    auto mask = std::make_shared<const FilterMask>(type, rows, cols, cutoff, order, high);
+    std::lock_guard<std::mutex> lock(mutex);
+    auto inserted = masks.emplace(key, mask);
+    if (inserted.second) {
+        built.push_back(key);
+        if (built.size() > MASK_CACHE_SIZE) {
+            masks.erase(built.front());
+            built.pop_front();
         }
     }
+    return inserted.first->second;
 }
 
-// butterworth filter
-void butterworth(std::vector<std::vector<cd>>& filter, double d, int order, bool high) {
-    int n = filter.size();
-    d *= d; d = std::max(d, EPS);
+// copies the gains of a mask to both parts of a matrix of the same size
+template <class T>
+static void fillFilter(BasicCMatrix<T>& filter, const FilterMask& mask) {
+    int n = filter.rows();
+    int m = filter.cols();
     for (int i = 0; i < n; i++) {
-        for (int j = 0; j < n; j++) {
-            double dist = (i - n / 2) * (i - n / 2) + (j - n / 2) * (j - n / 2);
-            double val = 1.0 / (1.0 + pow(dist / d, order));
-            if (high) val = 1.0 - val;
-            filter[i][j] = cd(val, val);
+        const double* gains = mask[i];
+        for (int j = 0; j < m; j++) {
+            T val = static_cast<T>(gains[j]);
+            filter[i][j] = std::complex<T>(val, val);
         }
     }
 }
 
+// ideal filter 
+template <class T>
+void ideal(BasicCMatrix<T>& filter, double d, int order, bool high) {
+    fillFilter(filter, *FilterMask::get(MASK_IDEAL, filter.rows(), filter.cols(), d, order, high));
+}
+
+template void ideal(CMatrix&, double, int, bool);
+template void ideal(CMatrixF&, double, int, bool);
+
+// gaussian filter
+template <class T>
+void gaussian(BasicCMatrix<T>& filter, double d, int order, bool high) {
+    fillFilter(filter, *FilterMask::get(MASK_GAUSSIAN, filter.rows(), filter.cols(), d, order, high));
+}
+
+template void gaussian(CMatrix&, double, int, bool);
+template void gaussian(CMatrixF&, double, int, bool);
+
+// butterworth filter
+template <class T>
+void butterworth(BasicCMatrix<T>& filter, double d, int order, bool high) {
+    fillFilter(filter, *FilterMask::get(MASK_BUTTERWORTH, filter.rows(), filter.cols(), d, order, high));
+}
+
+template void butterworth(CMatrix&, double, int, bool);
+template void butterworth(CMatrixF&, double, int, bool);
+
 // helper function implementation
 
-// performs transposition of matrix
-void transpose(std::vector<std::vector<cd>>& mat) {
-    int n = mat.size();
-    for (int i = 0; i < n; i++) {
-        for (int j = i + 1; j < n; j++) {
-            std::swap(mat[i][j], mat[j][i]);
-        }
+// performs transposition of matrix, TRANSPOSE_TILE x TRANSPOSE_TILE tiles at a time so that
+// both the rows read and the rows written stay in cache
+// square matrices are transposed in-place, swapping each tile with its mirror, and rectangular
+// ones through a copy; rows of tiles run in parallel, and touch disjoint elements
+template <class T>
+void transpose(BasicCMatrix<T>& mat) {
+    int n = mat.rows(), m = mat.cols();
+    int bands = (n + TRANSPOSE_TILE - 1) / TRANSPOSE_TILE;
+    int grain = std::max(1, PARALLEL_GRAIN / (TRANSPOSE_TILE * std::max(m, 1)));
+    if (n != m) {
+        BasicCMatrix<T> res(m, n);
+        parallelFor(0, bands, [&](int bandBegin, int bandEnd) {
+            for (int i0 = bandBegin * TRANSPOSE_TILE; i0 < std::min(bandEnd * TRANSPOSE_TILE, n); i0 += TRANSPOSE_TILE) {
+                for (int j0 = 0; j0 < m; j0 += TRANSPOSE_TILE) {
+                    int iEnd = std::min(i0 + TRANSPOSE_TILE, n), jEnd = std::min(j0 + TRANSPOSE_TILE, m);
+                    for (int i = i0; i < iEnd; i++) {
+                        for (int j = j0; j < jEnd; j++) res[j][i] = mat[i][j];
+                    }
+                }
+            }
+        }, grain);
+        mat.swap(res);
+        return;
     }
+    parallelFor(0, bands, [&](int bandBegin, int bandEnd) {
+        for (int i0 = bandBegin * TRANSPOSE_TILE; i0 < std::min(bandEnd * TRANSPOSE_TILE, n); i0 += TRANSPOSE_TILE) {
+            for (int j0 = i0; j0 < n; j0 += TRANSPOSE_TILE) {
+                int iEnd = std::min(i0 + TRANSPOSE_TILE, n), jEnd = std::min(j0 + TRANSPOSE_TILE, n);
+                for (int i = i0; i < iEnd; i++) {
+                    for (int j = std::max(j0, i + 1); j < jEnd; j++) std::swap(mat[i][j], mat[j][i]);
+                }
+            }
+        }
+    }, grain);
 }
 
+template void transpose(CMatrix&);
+template void transpose(CMatrixF&);
+
 // replaces the atomic entries in container with its conjugate
-void conjugate(std::vector<std::vector<cd>>& mat) {
-    for (auto& row : mat) {
-        for (auto& val : row) val = std::conj(val);
-    }
+template <class T>
+void conjugate(BasicCMatrix<T>& mat) {
+    std::complex<T>* values = mat.data();
+    for (size_t k = 0; k < static_cast<size_t>(mat.rows()) * mat.cols(); k++) values[k] = std::conj(values[k]);
 }
 
+template void conjugate(CMatrix&);
+template void conjugate(CMatrixF&);
+
 // perform (-1)^(i + j) operation over a matrix
-void cofactor(std::vector<std::vector<cd>>& mat) {
-    int n = mat.size();
-    int m = mat[0].size();
+template <class T>
+void cofactor(BasicCMatrix<T>& mat) {
+    int n = mat.rows();
+    int m = mat.cols();
     for (int i = 0; i < n; i++) {
         for (int j = 0; j < m; j++) {
             if ((i + j) & 1) mat[i][j] *= -1;
@@ -143,26 +979,34 @@ void cofactor(std::vector<std::vector<cd>>& mat) {
     }
 }
 
-// reads 2D std::vector object from cv::Mat object
-std::vector<std::vector<cd>> readVector(const cv::Mat& image) {
+template void cofactor(CMatrix&);
+template void cofactor(CMatrixF&);
+
+// reads a complex matrix from cv::Mat object
+template <class T>
+BasicCMatrix<T> readVector(const cv::Mat& image) {
     int n = image.rows;
     int m = image.cols;
-    std::vector<std::vector<cd>> res = std::vector<std::vector<cd>>(n, std::vector<cd>(m));
+    BasicCMatrix<T> res(n, m);
     for (int i = 0; i < n; i++) {
         for (int j = 0; j < m; j++) {
-            res[i][j] = cd(image.at<uchar>(i, j), 0);
+            res[i][j] = std::complex<T>(image.at<uchar>(i, j), 0);
             res[i][j] /= 255;
         }
     }
     return res;
 }
 
-// writes 2-D std::vector object to cv::Mat object
+template CMatrix readVector<double>(const cv::Mat&);
+template CMatrixF readVector<float>(const cv::Mat&);
+
+// writes a complex matrix to cv::Mat object
 // `mag` should be true if we need to consider magnitude of complex numbers
 // otherwise, only real part is considered
-void writeVector(cv::Mat& image, const std::vector<std::vector<cd>>& mat, bool mag) {
-    int n = mat.size();
-    int m = mat[0].size();
+template <class T>
+void writeVector(cv::Mat& image, const BasicCMatrix<T>& mat, bool mag) {
+    int n = mat.rows();
+    int m = mat.cols();
     assert(n == image.rows && m == image.cols);
     for (int i = 0; i < n; i++) {
         for (int j = 0; j < m; j++) {
@@ -173,8 +1017,98 @@ void writeVector(cv::Mat& image, const std::vector<std::vector<cd>>& mat, bool m
     }
 }
 
+template void writeVector(cv::Mat&, const CMatrix&, bool);
+template void writeVector(cv::Mat&, const CMatrixF&, bool);
+
+
+// multiplies the rows x (cols / 2 + 1) half spectrum `half` by a rows x cols filter centred
+// as by the filter generators, i.e. applying to the fftshift-ed full spectrum
+template <class T>
+void applyFilter(BasicCMatrix<T>& half, const BasicCMatrix<T>& filter) {
+    int n = filter.rows();
+    int m = filter.cols();
+    for (int i = 0; i < n; i++) {
+        const std::complex<T>* row = filter[(i + n / 2) % n];
+        for (int j = 0; j <= m / 2; j++) {
+            half[i][j] = dot(half[i][j], row[(j + m / 2) % m]);
+        }
+    }
+}
+
+template void applyFilter(CMatrix&, const CMatrix&);
+template void applyFilter(CMatrixF&, const CMatrixF&);
+
+// multiplies the half spectrum `half` by the real gains of a rows x cols mask, centred the same way
+template <class T>
+void applyFilter(BasicCMatrix<T>& half, const FilterMask& mask) {
+    int n = mask.getRows();
+    int m = mask.getCols();
+    for (int i = 0; i < n; i++) {
+        const double* gains = mask[(i + n / 2) % n];
+        for (int j = 0; j <= m / 2; j++) {
+            half[i][j] *= static_cast<T>(gains[(j + m / 2) % m]);
+        }
+    }
+}
+
+template void applyFilter(CMatrix&, const FilterMask&);
+template void applyFilter(CMatrixF&, const FilterMask&);
+
+// writes the gains of a mask to a cv::Mat object of the same size, as grey levels 0-255
+void writeMask(cv::Mat& image, const FilterMask& mask) {
+    int n = mask.getRows();
+    int m = mask.getCols();
+    assert(n == image.rows && m == image.cols);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < m; j++) {
+            image.at<uchar>(i, j) = static_cast<uchar>(std::min(255.0, std::max(0.0, mask[i][j] * 255)));
+        }
+    }
+}
+
+// reads a real matrix from cv::Mat object, scaled to [0, 1]
+template <class T>
+BasicRMatrix<T> readReal(const cv::Mat& image) {
+    int n = image.rows;
+    int m = image.cols;
+    BasicRMatrix<T> res(n, m);
+    for (int i = 0; i < n; i++) {
+        const uchar* src = image.ptr<uchar>(i);
+        T* dst = res[i];
+        for (int j = 0; j < m; j++) {
+            dst[j] = static_cast<T>(src[j] / 255.0);
+        }
+    }
+    return res;
+}
+
+template RMatrix readReal<double>(const cv::Mat&);
+template RMatrixF readReal<float>(const cv::Mat&);
+
+// writes a real matrix to cv::Mat object, as absolute values like writeVector
+template <class T>
+void writeReal(cv::Mat& image, const BasicRMatrix<T>& mat) {
+    int n = mat.rows();
+    int m = mat.cols();
+    assert(n == image.rows && m == image.cols);
+    for (int i = 0; i < n; i++) {
+        const T* src = mat[i];
+        uchar* dst = image.ptr<uchar>(i);
+        for (int j = 0; j < m; j++) {
+            double value = std::abs(static_cast<double>(src[j])) * 255;
+            dst[j] = std::min(255, static_cast<int>(value));
+        }
+    }
+}
+
+template void writeReal(cv::Mat&, const RMatrix&);
+template void writeReal(cv::Mat&, const RMatrixF&);
 
 // return dot product of two complex numbers
 cd dot(const cd& a, const cd& b) {
     return cd(a.real() * b.real(), a.imag() * b.imag());
 }
+
+cf dot(const cf& a, const cf& b) {
+    return cf(a.real() * b.real(), a.imag() * b.imag());
+}
@@ -0,0 +1,104 @@
+// Summed-area table implementation
+
+#include "integral.h"
+#include "parallel.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define INTEGRAL_SSE2
+#endif
+
+// rows per parallel task of the horizontal pass, columns per task of the vertical pass
+static const int ROW_BAND = 16;
+static const int COLUMN_BLOCK = 256;
+
+// writes the running sums of `src` and of its squares to `sum` and `square`, over `cols` pixels
+static void prefixRow(const uchar* src, uint64_t* sum, uint64_t* square, int cols) {
+	uint64_t runningSum = 0, runningSquare = 0;
+	int j = 0;
+#ifdef INTEGRAL_SSE2
+	// 4 pixels at a time: an in-register scan over 32-bit lanes (at most 4 * 255^2, so no
+	// overflow), widened to 64 bits and offset by the running totals of the previous pixels
+	const __m128i zero = _mm_setzero_si128();
+	auto scan = [](__m128i v) {
+		v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+		return _mm_add_epi32(v, _mm_slli_si128(v, 8));
+	};
+	auto store = [&](uint64_t* dst, __m128i v, uint64_t carry) {
+		__m128i base = _mm_set1_epi64x(static_cast<long long>(carry));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_add_epi64(base, _mm_unpacklo_epi32(v, zero)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2), _mm_add_epi64(base, _mm_unpackhi_epi32(v, zero)));
+	};
+	for (; j + 4 <= cols; j += 4) {
+		int packed;
+		std::copy(src + j, src + j + 4, reinterpret_cast<uchar*>(&packed));
+		__m128i pixels16 = _mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero);
+		__m128i pixels = _mm_unpacklo_epi16(pixels16, zero);
+		__m128i squared = _mm_unpacklo_epi16(_mm_mullo_epi16(pixels16, pixels16), zero); // 255^2 fits in 16 bits
+		pixels = scan(pixels);
+		squared = scan(squared);
+		store(sum + j, pixels, runningSum);
+		store(square + j, squared, runningSquare);
+		runningSum = sum[j + 3];
+		runningSquare = square[j + 3];
+	}
+#endif
+	for (; j < cols; j++) {
+		runningSum += src[j];
+		runningSquare += static_cast<uint64_t>(src[j]) * src[j];
+		sum[j] = runningSum;
+		square[j] = runningSquare;
+	}
+}
+
+// default constructor for IntegralImage
+IntegralImage::IntegralImage() : rows(0), cols(0) {}
+
+IntegralImage::IntegralImage(const cv::Mat& image) : rows(0), cols(0) {
+	compute(image);
+}
+
+// builds the tables in two passes on the thread pool:
+// running sums along every row, then the rows are accumulated down every block of columns
+void IntegralImage::compute(const cv::Mat& image) {
+	if (image.type() != CV_8UC1) throw std::runtime_error("IntegralImage takes CV_8UC1 images!");
+	rows = image.rows;
+	cols = image.cols;
+	size_t total = static_cast<size_t>(rows + 1) * (cols + 1);
+	sums.resize(total);
+	squares.resize(total);
+	std::fill(sums.begin(), sums.begin() + cols + 1, 0);
+	std::fill(squares.begin(), squares.begin() + cols + 1, 0);
+
+	parallelFor(0, rows, [&](int rowBegin, int rowEnd) {
+		for (int i = rowBegin; i < rowEnd; i++) {
+			sums[index(i + 1, 0)] = 0;
+			squares[index(i + 1, 0)] = 0;
+			prefixRow(image.ptr<uchar>(i), &sums[index(i + 1, 1)], &squares[index(i + 1, 1)], cols);
+		}
+	}, ROW_BAND);
+
+	// plain 64-bit additions over contiguous runs, which the compiler vectorizes
+	parallelFor(1, cols + 1, [&](int colBegin, int colEnd) {
+		for (int i = 2; i <= rows; i++) {
+			uint64_t* sum = &sums[index(i, 0)];
+			uint64_t* square = &squares[index(i, 0)];
+			const uint64_t* sumAbove = &sums[index(i - 1, 0)];
+			const uint64_t* squareAbove = &squares[index(i - 1, 0)];
+			for (int j = colBegin; j < colEnd; j++) {
+				sum[j] += sumAbove[j];
+				square[j] += squareAbove[j];
+			}
+		}
+	}, COLUMN_BLOCK);
+}
+
+// mean and variance of the window, from its sum and sum of squares
+void IntegralImage::windowStats(int i, int j, int size, double& mean, double& variance) const {
+	int size2 = size / 2;
+	int top = std::max(i - size2, 0), bottom = std::min(i + size2 + 1, rows);
+	int left = std::max(j - size2, 0), right = std::min(j + size2 + 1, cols);
+	double count = static_cast<double>(bottom - top) * (right - left);
+	mean = sum(top, left, bottom, right) / count;
+	variance = std::max(sumOfSquares(top, left, bottom, right) / count - mean * mean, 0.0);
+}
@@ -1,11 +1,15 @@
 // Morphological operation implementation
 
 #include "morph.h"
+#include "parallel.h"
 
 // constants
 
 const int BINARY_THRESHOLD = 127;
 
+// dynamic range of the standard deviation in Sauvola's threshold, for 8-bit images
+const double SAUVOLA_RANGE = 128;
+
 std::vector<std::string> OP_NAME = { "erosion", "dilation", "opening", "closing" };
 
 std::vector<std::string> STRUCT_ELEM_NAME = { "Rectangle 1x2", "Diamond 3x3", "Square 3x3", "Square 9x9", "Square 15x15" };
@@ -55,3 +59,38 @@ void binary(cv::Mat& image) {
 		}
 	}
 }
+
+/**
+* converting gray-scale image to binary, for unevenly lit images
+* every pixel is thresholded against the mean and standard deviation of the `size` x `size`
+* window around it (clipped to the image), which the summed-area tables give in O(1)
+* `k` is the constant C for ADAPTIVE_MEAN_C, typically 0.2 for ADAPTIVE_SAUVOLA
+* and -0.2 for ADAPTIVE_NIBLACK
+* throws unless `image` is CV_8UC1 and `size` is odd and positive
+*/
+void adaptiveBinary(cv::Mat& image, ThresholdMethod method, int size, double k) {
+	if (image.type() != CV_8UC1) throw std::runtime_error("adaptiveBinary takes CV_8UC1 images!");
+	if (size < 1 || size % 2 == 0) throw std::runtime_error("Window size of adaptiveBinary must be odd and positive!");
+	IntegralImage integral(image);
+	parallelFor(0, image.rows, [&](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			uchar* row = image.ptr<uchar>(i);
+			for (int j = 0; j < image.cols; j++) {
+				double mean, variance;
+				integral.windowStats(i, j, size, mean, variance);
+				double threshold;
+				switch (method) {
+				case ADAPTIVE_MEAN_C:
+					threshold = mean - k;
+					break;
+				case ADAPTIVE_NIBLACK:
+					threshold = mean + k * std::sqrt(variance);
+					break;
+				default:
+					threshold = mean * (1 + k * (std::sqrt(variance) / SAUVOLA_RANGE - 1));
+				}
+				row[j] = (row[j] > threshold) ? 255 : 0;
+			}
+		}
+	});
+}
@@ -0,0 +1,157 @@
+// Thread pool implementation
+
+#include "parallel.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// true while the current thread is running a chunk of a parallelFor
+static thread_local bool insideJob = false;
+
+// index of the current thread in the pool, 0 outside of it
+static thread_local int threadIndex = 0;
+
+// number of threads the last getNumThreads() returned to the current thread, 0 if none
+// its jobs run on at most that many threads, even if the pool has been resized since
+static thread_local int visibleThreads = 0;
+
+class ThreadPool {
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::mutex jobMutex;              // held by the caller of the running job
+	std::condition_variable wake;     // signals a new job (or shutdown) to the workers
+	std::condition_variable finished; // signals the caller that every worker checked out
+	unsigned generation = 0;          // incremented for every job
+	int remaining = 0;                // workers that have not finished the current job
+	bool stop = false;
+
+	// current job
+	void (*body)(void*, int, int) = nullptr;
+	void* ctx = nullptr;
+	int end = 0;
+	int chunk = 1;
+	int limit = 1; // threads of index >= limit sit the job out
+	std::atomic<int> next{ 0 };
+
+	// runs chunks of the current job until none is left
+	void work() {
+		insideJob = true;
+		for (int b = next.fetch_add(chunk); b < end; b = next.fetch_add(chunk)) {
+			body(ctx, b, std::min(b + chunk, end));
+		}
+		insideJob = false;
+	}
+
+	void loop(int index) {
+		threadIndex = index;
+		unsigned seen = 0;
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			wake.wait(lock, [&] { return stop || generation != seen; });
+			if (stop) return;
+			seen = generation;
+			bool join = index < limit;
+			lock.unlock();
+			if (join) work();
+			lock.lock();
+			if (--remaining == 0) finished.notify_one();
+		}
+	}
+
+public:
+	explicit ThreadPool(int threads) {
+		for (int i = 1; i < threads; i++) workers.emplace_back(&ThreadPool::loop, this, i);
+	}
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		wake.notify_all();
+		for (auto& worker : workers) worker.join();
+	}
+
+	int size() const {
+		return static_cast<int>(workers.size()) + 1;
+	}
+
+	// runs a job on the first `threads` threads of the pool, the caller included
+	// returns false without running anything if another job is in flight
+	bool run(int begin, int end_, void (*body_)(void*, int, int), void* ctx_, int grain, int threads) {
+		std::unique_lock<std::mutex> job(jobMutex, std::try_to_lock);
+		if (!job.owns_lock()) return false;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			body = body_;
+			ctx = ctx_;
+			end = end_;
+			limit = std::min(threads, size());
+			chunk = std::max(grain, (end_ - begin + 4 * limit - 1) / (4 * limit));
+			next = begin;
+			remaining = static_cast<int>(workers.size());
+			generation++;
+		}
+		wake.notify_all();
+		work();
+		std::unique_lock<std::mutex> lock(mutex);
+		finished.wait(lock, [&] { return remaining == 0; });
+		return true;
+	}
+};
+
+// the pool is swapped as a whole by setNumThreads; every job holds a reference to the pool it
+// runs on, so a pool replaced while jobs are in flight is destroyed once the last one returns
+static std::mutex poolMutex;
+static std::shared_ptr<ThreadPool> pool;
+
+// current pool, created with one thread per hardware thread on first use
+static std::shared_ptr<ThreadPool> currentPool() {
+	std::lock_guard<std::mutex> lock(poolMutex);
+	if (!pool) pool = std::make_shared<ThreadPool>(std::max(1, static_cast<int>(std::thread::hardware_concurrency())));
+	return pool;
+}
+
+// sets the number of threads used by parallelFor
+void setNumThreads(int threads) {
+	if (threads <= 0) threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	std::shared_ptr<ThreadPool> old;
+	{
+		std::lock_guard<std::mutex> lock(poolMutex);
+		if (pool && pool->size() == threads) return;
+		old = std::move(pool);
+		pool = std::make_shared<ThreadPool>(threads);
+	}
+	visibleThreads = 0;
+	// `old` is released outside the lock, joining its workers if no job holds it any more
+}
+
+// returns the number of threads used by parallelFor
+int getNumThreads() {
+	visibleThreads = currentPool()->size();
+	return visibleThreads;
+}
+
+// returns the index of the pool thread running the current chunk
+int getThreadIndex() {
+	return threadIndex;
+}
+
+// tells whether the calling thread is running a chunk of a parallelFor
+bool insideParallelFor() {
+	return insideJob;
+}
+
+void parallelForImpl(int begin, int end, void (*body)(void*, int, int), void* ctx, int grain) {
+	if (begin >= end) return;
+	if (!insideJob && end - begin > grain) {
+		std::shared_ptr<ThreadPool> running = currentPool();
+		int threads = visibleThreads ? visibleThreads : running->size();
+		if (threads > 1 && running->size() > 1 && running->run(begin, end, body, ctx, grain, threads)) return;
+	}
+	body(ctx, begin, end);
+}
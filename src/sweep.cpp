@@ -0,0 +1,209 @@
+// Headless filter sweep implementation
+
+#include "sweep.h"
+#include "filt.h"
+#include "parallel.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// writes images on a background thread, so that encoding overlaps with filtering
+class AsyncWriter {
+	static const size_t CAPACITY = 64; // pending images before `push` waits
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::deque<std::pair<std::string, cv::Mat>> queue;
+	bool done = false;
+	std::thread thread; // started last, once the members above exist
+
+	void loop() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			changed.wait(lock, [&] { return done || !queue.empty(); });
+			if (queue.empty()) return;
+			auto item = std::move(queue.front());
+			queue.pop_front();
+			lock.unlock();
+			changed.notify_all();
+			cv::imwrite(item.first, item.second);
+			lock.lock();
+		}
+	}
+
+public:
+	AsyncWriter() : thread(&AsyncWriter::loop, this) {}
+
+	// writes whatever is still queued before returning
+	~AsyncWriter() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			done = true;
+		}
+		changed.notify_all();
+		thread.join();
+	}
+
+	void push(const std::string& path, const cv::Mat& image) {
+		std::unique_lock<std::mutex> lock(mutex);
+		changed.wait(lock, [&] { return queue.size() < CAPACITY; });
+		queue.emplace_back(path, image);
+		lock.unlock();
+		changed.notify_all();
+	}
+};
+
+// images read ahead of the filtering, which is also the most files filtered in one parallel run
+static const size_t READ_AHEAD = 4;
+
+// reads images (as grey-scale) on a background thread, ahead of the filtering
+class AsyncReader {
+	const std::vector<std::string>& files;
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::deque<cv::Mat> queue; // in file order, empty for unreadable files
+	bool done = false;
+	std::thread thread; // started last, once the members above exist
+
+	void loop() {
+		for (auto& file : files) {
+			cv::Mat image = cv::imread(file, cv::IMREAD_GRAYSCALE);
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [&] { return done || queue.size() < READ_AHEAD; });
+			if (done) return;
+			queue.push_back(image);
+			lock.unlock();
+			changed.notify_all();
+		}
+	}
+
+public:
+	explicit AsyncReader(const std::vector<std::string>& files) : files(files), thread(&AsyncReader::loop, this) {}
+
+	// stops reading ahead, e.g. when the sweep is left early
+	~AsyncReader() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			done = true;
+		}
+		changed.notify_all();
+		thread.join();
+	}
+
+	// image of the next file, waiting for it to be read; empty if the file could not be read
+	cv::Mat pop() {
+		std::unique_lock<std::mutex> lock(mutex);
+		changed.wait(lock, [&] { return !queue.empty(); });
+		cv::Mat image = queue.front();
+		queue.pop_front();
+		lock.unlock();
+		changed.notify_all();
+		return image;
+	}
+
+	// tells whether the next image has already been read
+	bool ready() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return !queue.empty();
+	}
+};
+
+// FNV-1a hash of the pixels of `image`
+static unsigned long long checksum(const cv::Mat& image) {
+	unsigned long long hash = 14695981039346656037ULL;
+	size_t bytes = image.cols * image.elemSize();
+	for (int i = 0; i < image.rows; i++) {
+		const uchar* row = image.ptr<uchar>(i);
+		for (size_t j = 0; j < bytes; j++) {
+			hash ^= row[j];
+			hash *= 1099511628211ULL;
+		}
+	}
+	return hash;
+}
+
+/**
+* filters every image of `files` with every filter type x filter size
+* the kernels are built once for the whole sweep, so their cached spectra are shared by
+* every image of the same size, and every pool thread keeps one FilterWorkspace, so the
+* scratch memory is shared by all the combinations it runs
+* files are read ahead on a background thread, and every image already read joins the same
+* parallel run, so that the pool neither waits for the disk nor for the slowest combination of
+* each file; the filters called inside run serially on their thread
+*/
+std::vector<SweepResult> sweep(const std::vector<std::string>& files, const std::string& outputDirectory,
+                               const std::vector<int>& filterTypes, const std::vector<int>& filterSizes) {
+	int sizes = static_cast<int>(filterSizes.size());
+	int combinations = static_cast<int>(filterTypes.size()) * sizes;
+
+	std::vector<Kernel> kernels;
+	for (int type : filterTypes) {
+		for (int size : filterSizes) {
+			bool builtin = FILTERS[type][size] != nullptr;
+			kernels.push_back(builtin ? Kernel(type, size) : Kernel());
+		}
+	}
+	std::vector<FilterWorkspace> workspaces(getNumThreads());
+	std::unique_ptr<AsyncWriter> writer;
+	if (!outputDirectory.empty()) writer = std::make_unique<AsyncWriter>();
+	AsyncReader reader(files);
+
+	std::vector<SweepResult> results;
+	int count = static_cast<int>(files.size());
+	for (int file = 0; file < count;) {
+		// the next image, then every one the reader has ready, as (file, image)
+		std::vector<std::pair<int, cv::Mat>> batch;
+		do {
+			cv::Mat image = reader.pop();
+			if (image.data) batch.push_back({ file, image });
+			else std::cerr << "Error: cannot read " << files[file] << std::endl;
+			file++;
+		} while (file < count && batch.size() < READ_AHEAD && reader.ready());
+
+		size_t first = results.size();
+		int tasks = static_cast<int>(batch.size()) * combinations;
+		results.resize(first + tasks);
+
+		parallelFor(0, tasks, [&](int begin, int end) {
+			FilterWorkspace& ws = workspaces[getThreadIndex()];
+			for (int t = begin; t < end; t++) {
+				const cv::Mat& image = batch[t / combinations].second;
+				int c = t % combinations;
+				int type = filterTypes[c / sizes];
+				int size = filterSizes[c % sizes];
+				cv::Mat output;
+
+				auto start = std::chrono::steady_clock::now();
+				if (type == 0) output = image;
+				else if (type == 2) median(image, output, ws, size * 2 + 3);
+				else kernels[c].conv(image, output, ws);
+				std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+				int file = batch[t / combinations].first;
+				results[first + t] = { file, type, size, elapsed.count(), checksum(output) };
+				if (writer) {
+					writer->push(outputDirectory + "/" + std::to_string(file) + "_" + std::to_string(type) + "_"
+					             + std::to_string(size) + ".jpg", output);
+				}
+			}
+		});
+	}
+	return results;
+}
+
+// prints the timing table of a sweep
+void printSweep(std::ostream& out, const std::vector<SweepResult>& results, const std::vector<std::string>& files) {
+	out << std::left << std::setw(40) << "file" << std::setw(24) << "filter" << std::setw(6) << "size"
+	    << std::right << std::setw(12) << "ms" << "  checksum" << std::endl;
+	for (auto& result : results) {
+		out << std::left << std::setw(40) << files[result.file] << std::setw(24) << FILTER_NAME[result.filterType]
+		    << std::setw(6) << result.filterSize * 2 + 3 << std::right << std::setw(12) << std::fixed
+		    << std::setprecision(3) << result.milliseconds << "  " << std::hex << result.checksum << std::dec << std::endl;
+	}
+	out.unsetf(std::ios::floatfield);
+}
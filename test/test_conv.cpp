@@ -0,0 +1,256 @@
+#include <functional>
+#include "filt.h"
+
+int failures = 0;
+
+void expect(bool ok, const std::string& what) {
+    if (!ok) {
+        std::cout << "[FAIL] " << what << std::endl;
+        failures++;
+    }
+}
+
+// reference convolution: the generic loop over every tap, with zeros outside the image,
+// storing the sum the way Kernel::conv documents for each output type
+template <class In, class Out>
+cv::Mat referenceConv(const cv::Mat& image, const Kernel& kernel, int depth) {
+    cv::Mat result(image.rows, image.cols, CV_MAKETYPE(depth, image.channels()));
+    int size2 = kernel.getSize() / 2;
+    int cn = image.channels();
+    for (int i = 0; i < image.rows; i++) {
+        for (int j = 0; j < image.cols; j++) {
+            for (int c = 0; c < cn; c++) {
+                double pixel = 0;
+                for (int dx = -size2; dx <= size2; dx++) {
+                    for (int dy = -size2; dy <= size2; dy++) {
+                        int nx = i + dx, ny = j + dy;
+                        if (nx >= 0 && nx < image.rows && ny >= 0 && ny < image.cols) {
+                            pixel += kernel.at(dx, dy) * static_cast<double>(image.ptr<In>(nx)[ny * cn + c]);
+                        }
+                    }
+                }
+                Out& out = result.ptr<Out>(i)[j * cn + c];
+                if (depth == CV_8U) out = static_cast<Out>(std::min(255.0, std::max(0.0, pixel)));
+                else if (depth == CV_16S) out = cv::saturate_cast<Out>(pixel);
+                else out = static_cast<Out>(pixel);
+            }
+        }
+    }
+    return result;
+}
+
+// number of samples in which `a` and `b` differ
+template <class T>
+int mismatches(const cv::Mat& a, const cv::Mat& b) {
+    int count = 0;
+    for (int i = 0; i < a.rows; i++) {
+        for (int j = 0; j < a.cols * a.channels(); j++) count += a.ptr<T>(i)[j] != b.ptr<T>(i)[j];
+    }
+    return count;
+}
+
+// largest difference between two images of any depth, over the largest magnitude of `a`
+// (or 1 for 8-bit images, so that the difference counts grey levels)
+double difference(const cv::Mat& a, const cv::Mat& b) {
+    double worst = 0, scale = 0;
+    for (int i = 0; i < a.rows; i++) {
+        for (int j = 0; j < a.cols * a.channels(); j++) {
+            double x, y;
+            switch (a.depth()) {
+            case CV_8U: x = a.ptr<uchar>(i)[j]; y = b.ptr<uchar>(i)[j]; break;
+            case CV_32F: x = a.ptr<float>(i)[j]; y = b.ptr<float>(i)[j]; break;
+            default: x = a.ptr<double>(i)[j]; y = b.ptr<double>(i)[j];
+            }
+            worst = std::max(worst, std::abs(x - y));
+            scale = std::max(scale, std::abs(x));
+        }
+    }
+    return a.depth() == CV_8U ? worst : worst / std::max(scale, 1e-300);
+}
+
+// every built-in kernel, HIGH_PASS included, with its name
+std::vector<std::pair<std::string, Kernel>> builtinKernels() {
+    std::vector<std::pair<std::string, Kernel>> kernels;
+    for (int type = 0; type < 11; type++) {
+        for (int size = 0; size < 4; size++) {
+            if (FILTERS[type][size]) kernels.push_back({ std::string(FILTER_NAME[type]) + "_" + std::to_string(size * 2 + 3), Kernel(type, size) });
+        }
+    }
+    kernels.push_back({ "HIGH_PASS", Kernel(3, HIGH_PASS.data()) });
+    return kernels;
+}
+
+int main() {
+    // odd shapes, some smaller than the kernels, so that borders and tiny images are covered
+    std::vector<cv::Size> shapes = { {1, 1}, {4, 3}, {9, 9}, {17, 12}, {64, 41} };
+    auto kernels = builtinKernels();
+
+    // compile-time specializations against the generic loop, for every pipeline that has them
+    for (int channels : { 1, 3 }) {
+        for (auto& shape : shapes) {
+            cv::Mat grey(shape, CV_MAKETYPE(CV_8U, channels)), real(shape, CV_MAKETYPE(CV_32F, channels));
+            cv::Mat wide(shape, CV_MAKETYPE(CV_16S, channels));
+            cv::randu(grey, 0, 256);
+            cv::randu(real, -100, 100);
+            cv::randu(wide, -300, 300);
+            for (auto& named : kernels) {
+                Kernel& kernel = named.second;
+                std::string what = named.first + " on " + std::to_string(shape.width) + "x" + std::to_string(shape.height)
+                                 + "x" + std::to_string(channels);
+                expect(mismatches<uchar>(kernel.conv(grey, CONV_DIRECT), referenceConv<uchar, uchar>(grey, kernel, CV_8U)) == 0,
+                       what + ", 8-bit");
+                expect(mismatches<short>(kernel.conv(grey, CV_16S, CONV_DIRECT), referenceConv<uchar, short>(grey, kernel, CV_16S)) == 0,
+                       what + ", 8-bit to 16-bit");
+                expect(mismatches<float>(kernel.conv(grey, CV_32F, CONV_DIRECT), referenceConv<uchar, float>(grey, kernel, CV_32F)) == 0,
+                       what + ", 8-bit to float");
+                expect(mismatches<float>(kernel.conv(real, CONV_DIRECT), referenceConv<float, float>(real, kernel, CV_32F)) == 0,
+                       what + ", float");
+                // pipelines without specializations
+                expect(mismatches<double>(kernel.conv(grey, CV_64F, CONV_DIRECT), referenceConv<uchar, double>(grey, kernel, CV_64F)) == 0,
+                       what + ", 8-bit to double");
+                expect(mismatches<double>(kernel.conv(real, CV_64F, CONV_DIRECT), referenceConv<float, double>(real, kernel, CV_64F)) == 0,
+                       what + ", float to double");
+                expect(mismatches<short>(kernel.conv(wide, CONV_DIRECT), referenceConv<short, short>(wide, kernel, CV_16S)) == 0,
+                       what + ", 16-bit");
+                expect(mismatches<float>(kernel.conv(wide, CV_32F, CONV_DIRECT), referenceConv<short, float>(wide, kernel, CV_32F)) == 0,
+                       what + ", 16-bit to float");
+            }
+        }
+    }
+
+    // filter banks against one direct convolution per kernel, for built-in and mixed-size banks
+    cv::Mat image(83, 97, CV_8UC1);
+    cv::randu(image, 0, 256);
+    cv::RNG rng(3);
+    std::vector<std::vector<Kernel>> banks;
+    for (int size = 0; size < 4; size++) banks.push_back({ Kernel(5, size), Kernel(6, size), Kernel(7, size) });
+    std::vector<Kernel> mixed;
+    for (int size : { 3, 7, 5, 1 }) {
+        std::vector<double> taps(size * size);
+        for (auto& tap : taps) tap = rng.uniform(-2.0, 2.0);
+        mixed.emplace_back(size, taps);
+    }
+    banks.push_back(mixed);
+    for (auto& kernels : banks) {
+        auto responses = FilterBank(kernels).apply(image);
+        for (size_t k = 0; k < kernels.size(); k++) {
+            expect(mismatches<short>(responses[k], kernels[k].conv(image, CV_16S, CONV_DIRECT)) == 0,
+                   "filter bank response of a " + std::to_string(kernels[k].getSize()) + "x" + std::to_string(kernels[k].getSize()) + " kernel");
+        }
+    }
+
+    // gradient magnitude and orientation of vertical, horizontal and diagonal steps
+    for (int step = 0; step < 3; step++) {
+        cv::Mat edge(40, 50, CV_8UC1);
+        for (int i = 0; i < edge.rows; i++) {
+            for (int j = 0; j < edge.cols; j++) {
+                bool bright = step == 0 ? j >= 25 : step == 1 ? i >= 20 : i + j >= 45;
+                edge.at<uchar>(i, j) = bright ? 200 : 30;
+            }
+        }
+        cv::Mat magnitude, orientation;
+        FilterBank({ 5, 6 }, 0).apply(edge, &magnitude, &orientation);
+        cv::Mat gx = Kernel(5, 0).conv(edge, CV_64F, CONV_DIRECT), gy = Kernel(6, 0).conv(edge, CV_64F, CONV_DIRECT);
+        double expected = step == 0 ? 0 : step == 1 ? acos(-1) / 2 : acos(-1) / 4;
+        int wrong = 0, across = 0;
+        for (int i = 0; i < edge.rows; i++) {
+            for (int j = 0; j < edge.cols; j++) {
+                double x = gx.at<double>(i, j), y = gy.at<double>(i, j);
+                wrong += magnitude.at<float>(i, j) != static_cast<float>(hypot(x, y));
+                wrong += orientation.at<float>(i, j) != static_cast<float>(atan2(y, x));
+                // away from the image border, the gradient across the step points to the bright side
+                bool inside = i > 1 && i < edge.rows - 2 && j > 1 && j < edge.cols - 2;
+                if (inside && magnitude.at<float>(i, j) > 100) {
+                    across++;
+                    wrong += std::abs(orientation.at<float>(i, j) - expected) > 1e-6;
+                }
+            }
+        }
+        expect(wrong == 0 && across > 0, "gradient magnitude and orientation of step " + std::to_string(step));
+    }
+
+    // a gradient needs two kernels, and only 8-bit single-channel images are filtered
+    cv::Mat colour(9, 11, CV_8UC3), magnitude;
+    std::vector<std::pair<std::string, std::function<void()>>> rejected = {
+        { "a gradient of one kernel", [&] { FilterBank({ 5 }, 0).apply(image, &magnitude); } },
+        { "a CV_8UC3 image", [&] { FilterBank({ 5, 6 }, 0).apply(colour); } },
+        { "a CV_16SC1 image", [&] { FilterBank({ 5, 6 }, 0).apply(cv::Mat(9, 11, CV_16SC1)); } },
+    };
+    for (auto& call : rejected) {
+        bool thrown = false;
+        try {
+            call.second();
+        }
+        catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        expect(thrown, "filter bank accepted " + call.first);
+    }
+
+    // every strategy against the direct one, on built-in, random separable and random kernels:
+    // within one grey level for 8-bit results, and within rounding for floating point ones
+    std::vector<std::pair<std::string, Kernel>> all = kernels;
+    for (int size : { 3, 7, 11 }) {
+        std::vector<double> row(size), col(size), taps(size * size), outer(size * size);
+        for (auto& v : row) v = rng.uniform(-1.0, 1.0);
+        for (auto& v : col) v = rng.uniform(-1.0, 1.0);
+        for (int k = 0; k < size * size; k++) {
+            outer[k] = col[k / size] * row[k % size];
+            taps[k] = rng.uniform(-0.2, 0.2);
+        }
+        all.push_back({ "random separable " + std::to_string(size), Kernel(size, outer) });
+        all.push_back({ "random " + std::to_string(size), Kernel(size, taps) });
+    }
+    for (int type : { CV_8UC1, CV_8UC3, CV_32FC1 }) {
+        cv::Mat input(71, 58, type);
+        cv::randu(input, 0, 256);
+        for (auto& named : all) {
+            Kernel& kernel = named.second;
+            // float images are compared in double, so that only the strategies themselves differ;
+            // the factors of the built-in kernels only hold to the 8 decimals of their tables
+            int depth = input.depth() == CV_8U ? CV_8U : CV_64F;
+            cv::Mat direct = kernel.conv(input, depth, CONV_DIRECT);
+            for (ConvStrategy strategy : { CONV_SEPARABLE, CONV_FFT, CONV_AUTO }) {
+                bool rounded = strategy == CONV_SEPARABLE && named.first.compare(0, 6, "random");
+                double bound = depth == CV_8U ? 1 : rounded ? 1e-7 : 1e-9;
+                double error = difference(direct, kernel.conv(input, depth, strategy));
+                expect(error <= bound, named.first + " with strategy " + std::to_string(strategy) + " on type "
+                                       + std::to_string(type) + ": difference " + std::to_string(error));
+            }
+            if (depth == CV_64F) {
+                double error = difference(kernel.conv(input, CV_32F, CONV_DIRECT), kernel.conv(input, CV_32F, CONV_FFT));
+                expect(error <= 1e-6, named.first + " in float: difference " + std::to_string(error));
+            }
+        }
+    }
+    // wide results brought back to 8 bits store what an 8-bit convolution stores: exactly from
+    // double, and from float whenever it holds the sums exactly (integer taps); fractional sums
+    // just below a level may round up to it in float, so those agree within one level
+    for (int type : { CV_8UC1, CV_8UC3 }) {
+        cv::Mat input(53, 67, type);
+        cv::randu(input, 0, 256);
+        for (auto& named : kernels) {
+            Kernel& kernel = named.second;
+            bool integer = true;
+            int size2 = kernel.getSize() / 2;
+            for (int dx = -size2; dx <= size2; dx++) {
+                for (int dy = -size2; dy <= size2; dy++) integer = integer && kernel.at(dx, dy) == std::round(kernel.at(dx, dy));
+            }
+            cv::Mat narrow = kernel.conv(input, CONV_DIRECT);
+            std::string what = "saturate of " + named.first + " on " + std::to_string(input.channels()) + " channels";
+            expect(mismatches<uchar>(saturate(kernel.conv(input, CV_64F, CONV_DIRECT)), narrow) == 0, what + " from double");
+            cv::Mat single = saturate(kernel.conv(input, CV_32F, CONV_DIRECT));
+            expect(integer ? mismatches<uchar>(single, narrow) == 0 : difference(narrow, single) <= 1, what + " from float");
+        }
+    }
+
+    // only the pipelines with a specialization get its cost: a 9x9 LAPLACIAN_OF_GAUSSIAN is
+    // convolved directly into float, but costs enough without one to go through the FFT
+    Kernel log9(10, 3);
+    expect(log9.pickStrategy(1020, 1020, CV_8U, CV_32F) == CONV_DIRECT, "specialized pipeline costed as specialized");
+    expect(log9.pickStrategy(1020, 1020, CV_8U, CV_64F) == CONV_FFT, "8-bit to double costed as generic");
+    expect(log9.pickStrategy(1020, 1020, CV_16S, CV_16S) == CONV_FFT, "16-bit costed as generic");
+
+    std::cout << (failures ? "[FAILED]" : "[PASSED]") << " specialized convolution, filter banks and convolution strategies" << std::endl;
+    return failures != 0;
+}
@@ -0,0 +1,357 @@
+#include <chrono>
+#include <cmath>
+#include "denoise.h"
+#include "filt.h"
+
+// reference bilateral filter: Gaussian spatial and range weights over a window of
+// radius 3 * sigmaSpace, normalized over the in-bounds pixels
+cv::Mat referenceBilateral(const cv::Mat& image, double sigmaSpace, double sigmaRange) {
+    cv::Mat result = image.clone();
+    int radius = static_cast<int>(std::ceil(3 * sigmaSpace));
+    for (int i = 0; i < image.rows; i++) {
+        for (int j = 0; j < image.cols; j++) {
+            double center = image.at<uchar>(i, j);
+            double sum = 0, weight = 0;
+            for (int dx = -radius; dx <= radius; dx++) {
+                for (int dy = -radius; dy <= radius; dy++) {
+                    int nx = i + dx;
+                    int ny = j + dy;
+                    if (nx >= 0 && nx < image.rows && ny >= 0 && ny < image.cols) {
+                        double value = image.at<uchar>(nx, ny);
+                        double w = std::exp(-(dx * dx + dy * dy) / (2 * sigmaSpace * sigmaSpace)
+                                            - (value - center) * (value - center) / (2 * sigmaRange * sigmaRange));
+                        sum += w * value;
+                        weight += w;
+                    }
+                }
+            }
+            result.at<uchar>(i, j) = cv::saturate_cast<uchar>(sum / weight);
+        }
+    }
+    return result;
+}
+
+// reference non-local means: patch distances summed directly, borders replicated
+cv::Mat referenceNonLocalMeans(const cv::Mat& image, double h, int searchSize, int patchSize) {
+    cv::Mat result = image.clone();
+    int searchRadius = searchSize / 2, patchRadius = patchSize / 2;
+    auto pixel = [&](int i, int j) {
+        return static_cast<double>(image.at<uchar>(std::min(std::max(i, 0), image.rows - 1),
+                                                   std::min(std::max(j, 0), image.cols - 1)));
+    };
+    for (int i = 0; i < image.rows; i++) {
+        for (int j = 0; j < image.cols; j++) {
+            double sum = 0, weight = 0, maxWeight = 0;
+            for (int dy = -searchRadius; dy <= searchRadius; dy++) {
+                for (int dx = -searchRadius; dx <= searchRadius; dx++) {
+                    if (dy == 0 && dx == 0) continue;
+                    double distance = 0;
+                    for (int py = -patchRadius; py <= patchRadius; py++) {
+                        for (int px = -patchRadius; px <= patchRadius; px++) {
+                            double d = pixel(i + py, j + px) - pixel(i + dy + py, j + dx + px);
+                            distance += d * d;
+                        }
+                    }
+                    distance /= patchSize * patchSize;
+                    double w = std::exp(-distance / (h * h));
+                    sum += w * pixel(i + dy, j + dx);
+                    weight += w;
+                    maxWeight = std::max(maxWeight, w);
+                }
+            }
+            if (maxWeight == 0) maxWeight = 1;
+            result.at<uchar>(i, j) = cv::saturate_cast<uchar>((sum + maxWeight * pixel(i, j)) / (weight + maxWeight));
+        }
+    }
+    return result;
+}
+
+// reference guided filter: every box mean summed directly in double, 3 x 3 systems solved
+// by Gaussian elimination
+cv::Mat referenceGuided(const cv::Mat& guide, const cv::Mat& target, int radius, double eps) {
+    int rows = target.rows, cols = target.cols, channels = guide.channels();
+    auto I = [&](int i, int j, int c) { return guide.ptr<uchar>(i)[j * channels + c] / 255.0; };
+    auto p = [&](int i, int j) { return target.at<uchar>(i, j) / 255.0; };
+    // clipped box mean of f(y, x)
+    auto box = [&](int i, int j, auto f) {
+        double sum = 0;
+        int count = 0;
+        for (int y = std::max(i - radius, 0); y <= std::min(i + radius, rows - 1); y++) {
+            for (int x = std::max(j - radius, 0); x <= std::min(j + radius, cols - 1); x++) {
+                sum += f(y, x);
+                count++;
+            }
+        }
+        return sum / count;
+    };
+    std::vector<std::vector<double>> a(channels + 1, std::vector<double>(rows * cols));
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            double meanP = box(i, j, p), mean[3], m[3][4];
+            for (int c = 0; c < channels; c++) mean[c] = box(i, j, [&](int y, int x) { return I(y, x, c); });
+            for (int c = 0; c < channels; c++) {
+                for (int d = 0; d < channels; d++) {
+                    m[c][d] = box(i, j, [&](int y, int x) { return I(y, x, c) * I(y, x, d); }) - mean[c] * mean[d] + (c == d) * eps;
+                }
+                m[c][channels] = box(i, j, [&](int y, int x) { return I(y, x, c) * p(y, x); }) - mean[c] * meanP;
+            }
+            for (int c = 0; c < channels; c++) {
+                for (int r = c + 1; r < channels; r++) {
+                    double f = m[r][c] / m[c][c];
+                    for (int k = c; k <= channels; k++) m[r][k] -= f * m[c][k];
+                }
+            }
+            double b = meanP;
+            for (int c = channels - 1; c >= 0; c--) {
+                double value = m[c][channels];
+                for (int k = c + 1; k < channels; k++) value -= m[c][k] * a[k][i * cols + j];
+                a[c][i * cols + j] = value / m[c][c];
+                b -= a[c][i * cols + j] * mean[c];
+            }
+            a[channels][i * cols + j] = b;
+        }
+    }
+    cv::Mat result(rows, cols, CV_8UC1);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            double q = box(i, j, [&](int y, int x) { return a[channels][y * cols + x]; });
+            for (int c = 0; c < channels; c++) {
+                q += box(i, j, [&](int y, int x) { return a[c][y * cols + x]; }) * I(i, j, c);
+            }
+            result.at<uchar>(i, j) = cv::saturate_cast<uchar>(q * 255);
+        }
+    }
+    return result;
+}
+
+// largest absolute difference between two CV_8UC1 images
+int maxDifference(const cv::Mat& a, const cv::Mat& b) {
+    int worst = 0;
+    for (int i = 0; i < a.rows; i++) {
+        for (int j = 0; j < a.cols; j++) worst = std::max(worst, std::abs(a.at<uchar>(i, j) - b.at<uchar>(i, j)));
+    }
+    return worst;
+}
+
+// peak signal to noise ratio of `a` against `b`, in dB
+double psnr(const cv::Mat& a, const cv::Mat& b) {
+    double error = 0;
+    for (int i = 0; i < a.rows; i++) {
+        for (int j = 0; j < a.cols; j++) {
+            double d = a.at<uchar>(i, j) - b.at<uchar>(i, j);
+            error += d * d;
+        }
+    }
+    error /= a.rows * a.cols;
+    return (error > 0) ? 10 * std::log10(255 * 255 / error) : INFINITY;
+}
+
+// noisy piecewise-constant image: a bright disc and a dark stripe over a ramp
+cv::Mat testImage(int rows, int cols) {
+    cv::Mat image(rows, cols, CV_8UC1);
+    cv::Mat noise(rows, cols, CV_8UC1);
+    cv::randu(noise, 0, 41);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            int value = 40 + 60 * j / cols;
+            if ((i - rows / 2) * (i - rows / 2) + (j - cols / 3) * (j - cols / 3) < rows * rows / 16) value = 200;
+            if (j > 2 * cols / 3 && j < 2 * cols / 3 + cols / 8) value = 10;
+            image.at<uchar>(i, j) = cv::saturate_cast<uchar>(value + noise.at<uchar>(i, j) - 20);
+        }
+    }
+    return image;
+}
+
+// noise-free image with flat regions, edges and a fine periodic texture
+cv::Mat cleanImage(int rows, int cols) {
+    cv::Mat image(rows, cols, CV_8UC1);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            int value = 60 + 80 * i / rows;
+            if (j > cols / 2) value = ((i / 3 + j / 3) % 2) ? 190 : 120;
+            if ((i - rows / 3) * (i - rows / 3) + (j - cols / 4) * (j - cols / 4) < rows * rows / 25) value = 220;
+            image.at<uchar>(i, j) = static_cast<uchar>(value);
+        }
+    }
+    return image;
+}
+
+// `image` with approximately Gaussian noise of standard deviation `sigma` (sum of uniforms)
+cv::Mat addNoise(const cv::Mat& image, double sigma) {
+    cv::Mat result = image.clone();
+    std::vector<cv::Mat> uniforms(4, cv::Mat(image.rows, image.cols, CV_32F));
+    for (auto& u : uniforms) {
+        u = cv::Mat(image.rows, image.cols, CV_32F);
+        cv::randu(u, -1, 1);
+    }
+    // the sum of 4 uniforms on [-1, 1] has variance 4 / 3
+    double scale = sigma / std::sqrt(4 / 3.0);
+    for (int i = 0; i < image.rows; i++) {
+        for (int j = 0; j < image.cols; j++) {
+            double noise = 0;
+            for (auto& u : uniforms) noise += u.at<float>(i, j);
+            result.at<uchar>(i, j) = cv::saturate_cast<uchar>(image.at<uchar>(i, j) + scale * noise);
+        }
+    }
+    return result;
+}
+
+double milliseconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main() {
+    std::vector<cv::Size> shapes = { {1, 1}, {7, 3}, {160, 120} };
+    std::vector<double> sigmaSpaces = { 2, 4, 8 };
+    std::vector<double> sigmaRanges = { 15, 30, 60 };
+    // the grid quantizes position and intensity by one sigma, which limits how close it gets
+    const double MIN_PSNR = 30;
+    int failures = 0;
+
+    for (auto& shape : shapes) {
+        cv::Mat image = testImage(shape.height, shape.width);
+        for (double sigmaSpace : sigmaSpaces) {
+            for (double sigmaRange : sigmaRanges) {
+                auto start = std::chrono::steady_clock::now();
+                cv::Mat fast = bilateral(image, sigmaSpace, sigmaRange);
+                double fastTime = milliseconds(start);
+                start = std::chrono::steady_clock::now();
+                cv::Mat reference = referenceBilateral(image, sigmaSpace, sigmaRange);
+                double referenceTime = milliseconds(start);
+
+                double quality = psnr(fast, reference);
+                bool failed = quality < MIN_PSNR;
+                std::cout << (failed ? "[FAIL] " : "[OK]   ") << shape.width << "x" << shape.height
+                          << " sigmaSpace=" << sigmaSpace << " sigmaRange=" << sigmaRange
+                          << ": PSNR " << quality << " dB, grid " << fastTime << " ms, brute force "
+                          << referenceTime << " ms" << std::endl;
+                failures += failed;
+            }
+        }
+    }
+
+    // small sigmas on a 4K image coarsen the grid instead of allocating without limit
+    cv::Mat flat(2160, 3840, CV_8UC1, cv::Scalar(77));
+    if (maxDifference(bilateral(flat, 1, 1), flat) != 0) {
+        std::cout << "[FAIL] bilateral of a constant 4K image with unit sigmas" << std::endl;
+        failures++;
+    }
+    for (int type : { CV_8UC3, CV_16UC1, CV_32FC1 }) {
+        bool thrown = false;
+        try {
+            bilateral(cv::Mat(8, 8, type, cv::Scalar(0)), 2, 15);
+        }
+        catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        if (!thrown) {
+            std::cout << "[FAIL] bilateral accepts type " << type << std::endl;
+            failures++;
+        }
+    }
+    std::cout << (failures ? "[FAILED]" : "[PASSED]") << " bilateral grid accuracy" << std::endl;
+
+    // non-local means against the direct evaluation; only rounding of the weights may differ
+    int nlmFailures = 0;
+    for (auto& shape : shapes) {
+        cv::Mat image = testImage(shape.height, shape.width);
+        for (int patchSize : { 3, 7 }) {
+            cv::Mat fast = nonLocalMeans(image, 20, 11, patchSize);
+            cv::Mat reference = referenceNonLocalMeans(image, 20, 11, patchSize);
+            int worst = maxDifference(fast, reference);
+            if (worst > 1) {
+                std::cout << "[FAIL] non-local means " << shape.width << "x" << shape.height << " patch " << patchSize
+                          << ": differs from the direct evaluation by " << worst << std::endl;
+                nlmFailures++;
+            }
+        }
+    }
+
+    // denoising quality against the median filter, PSNR to the noise-free image
+    cv::Mat clean = cleanImage(240, 320);
+    for (double sigma : { 10, 20, 30 }) {
+        cv::Mat noisy = addNoise(clean, sigma);
+        auto start = std::chrono::steady_clock::now();
+        cv::Mat nlm = nonLocalMeans(noisy, sigma);
+        double nlmTime = milliseconds(start);
+        double best = 0;
+        int bestSize = 0;
+        for (int size : { 3, 5, 7 }) {
+            double quality = psnr(median(noisy, size), clean);
+            if (quality > best) {
+                best = quality;
+                bestSize = size;
+            }
+        }
+        double quality = psnr(nlm, clean);
+        bool failed = quality <= best;
+        std::cout << (failed ? "[FAIL] " : "[OK]   ") << "noise sigma=" << sigma << ": noisy " << psnr(noisy, clean)
+                  << " dB, median " << bestSize << "x" << bestSize << " " << best << " dB, non-local means "
+                  << quality << " dB in " << nlmTime << " ms" << std::endl;
+        nlmFailures += failed;
+    }
+    for (int type : { CV_8UC3, CV_16UC1 }) {
+        bool thrown = false;
+        try {
+            nonLocalMeans(cv::Mat(8, 8, type, cv::Scalar(0)), 20);
+        }
+        catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        if (!thrown) {
+            std::cout << "[FAIL] non-local means accepts type " << type << std::endl;
+            nlmFailures++;
+        }
+    }
+    std::cout << (nlmFailures ? "[FAILED]" : "[PASSED]") << " non-local means accuracy and quality" << std::endl;
+
+    // guided filter against the direct evaluation, self-guided and with a colour guide
+    int guidedFailures = 0;
+    for (auto& shape : shapes) {
+        cv::Mat target = testImage(shape.height, shape.width);
+        cv::Mat colour(shape.height, shape.width, CV_8UC3);
+        cv::randu(colour, 0, 256);
+        for (int i = 0; i < shape.height; i++) {
+            for (int j = 0; j < shape.width; j++) colour.ptr<uchar>(i)[j * 3 + 1] = target.at<uchar>(i, j);
+        }
+        for (int radius : { 1, 4, 9 }) {
+            for (double eps : { 0.001, 0.04 }) {
+                for (const cv::Mat* guide : { &target, &colour }) {
+                    int worst = maxDifference(guidedFilter(*guide, target, radius, eps),
+                                              referenceGuided(*guide, target, radius, eps));
+                    if (worst > 1) {
+                        std::cout << "[FAIL] guided filter " << shape.width << "x" << shape.height << " radius " << radius
+                                  << " eps " << eps << " with " << guide->channels() << " channel guide differs by "
+                                  << worst << std::endl;
+                        guidedFailures++;
+                    }
+                }
+            }
+        }
+    }
+
+    // the fast guided filter against the exact one, and the cost against the radius
+    cv::Mat large = testImage(480, 640);
+    for (int radius : { 4, 16, 64 }) {
+        auto start = std::chrono::steady_clock::now();
+        cv::Mat exact = guidedFilter(large, large, radius, 0.01);
+        double exactTime = milliseconds(start);
+        for (int subsample : { 2, 4 }) {
+            start = std::chrono::steady_clock::now();
+            cv::Mat fast = guidedFilter(large, large, radius, 0.01, subsample);
+            double fastTime = milliseconds(start);
+            double quality = psnr(fast, exact);
+            bool failed = quality < 30;
+            std::cout << (failed ? "[FAIL] " : "[OK]   ") << "guided filter radius " << radius << ": exact " << exactTime
+                      << " ms, subsampled by " << subsample << " " << fastTime << " ms, PSNR " << quality << " dB" << std::endl;
+            guidedFailures += failed;
+        }
+    }
+    // a detail gain of 1 gives back the image
+    if (maxDifference(guidedEnhance(large, 8, 0.01, 1), large) != 0) {
+        std::cout << "[FAIL] guided enhancement with amount 1 changes the image" << std::endl;
+        guidedFailures++;
+    }
+    std::cout << (guidedFailures ? "[FAILED]" : "[PASSED]") << " guided filter accuracy" << std::endl;
+    return failures + nlmFailures + guidedFailures != 0;
+}
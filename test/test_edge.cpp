@@ -0,0 +1,189 @@
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include "edge.h"
+
+// reference Canny over whole-image buffers: Gaussian, Sobel, non-maximum suppression and
+// breadth-first hysteresis, one full pass each
+cv::Mat referenceCanny(const cv::Mat& image, double low, double high, double sigma) {
+    int rows = image.rows, cols = image.cols;
+    int radius = static_cast<int>(std::ceil(3 * sigma));
+    std::vector<double> taps(2 * radius + 1);
+    double total = 0;
+    for (int k = -radius; k <= radius; k++) total += taps[k + radius] = std::exp(-k * k / (2 * sigma * sigma));
+    auto clampRow = [&](int i) { return std::min(std::max(i, 0), rows - 1); };
+    auto clampCol = [&](int j) { return std::min(std::max(j, 0), cols - 1); };
+
+    std::vector<double> vertical(rows * cols), smoothed(rows * cols);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            double sum = 0;
+            for (int k = -radius; k <= radius; k++) sum += taps[k + radius] / total * image.at<uchar>(clampRow(i + k), j);
+            vertical[i * cols + j] = sum;
+        }
+    }
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            double sum = 0;
+            for (int k = -radius; k <= radius; k++) sum += taps[k + radius] / total * vertical[i * cols + clampCol(j + k)];
+            smoothed[i * cols + j] = sum;
+        }
+    }
+
+    std::vector<double> gx(rows * cols), gy(rows * cols), magnitude(rows * cols);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            double x = 0, y = 0;
+            for (int di = -1; di <= 1; di++) {
+                for (int dj = -1; dj <= 1; dj++) {
+                    double value = smoothed[clampRow(i + di) * cols + clampCol(j + dj)];
+                    x += SOBEL_H_3[(di + 1) * 3 + dj + 1] * value;
+                    y += SOBEL_V_3[(di + 1) * 3 + dj + 1] * value;
+                }
+            }
+            gx[i * cols + j] = x;
+            gy[i * cols + j] = y;
+            magnitude[i * cols + j] = std::sqrt(x * x + y * y);
+        }
+    }
+    auto at = [&](int i, int j) {
+        return (i >= 0 && i < rows && j >= 0 && j < cols) ? magnitude[i * cols + j] : 0.0;
+    };
+
+    // 0 = no edge, 1 = weak, 2 = strong
+    std::vector<int> classes(rows * cols, 0);
+    std::deque<std::pair<int, int>> queue;
+    const double angle = std::tan(M_PI / 8);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            double m = magnitude[i * cols + j], x = gx[i * cols + j], y = gy[i * cols + j];
+            if (m <= low) continue;
+            int di, dj;
+            if (std::abs(y) <= angle * std::abs(x)) di = 0, dj = 1;
+            else if (std::abs(x) <= angle * std::abs(y)) di = 1, dj = 0;
+            else di = 1, dj = ((x < 0) == (y < 0)) ? 1 : -1;
+            if (m > at(i - di, j - dj) && m >= at(i + di, j + dj)) {
+                classes[i * cols + j] = (m > high) ? 2 : 1;
+                if (m > high) queue.emplace_back(i, j);
+            }
+        }
+    }
+    cv::Mat result(rows, cols, CV_8UC1, cv::Scalar(0));
+    while (!queue.empty()) {
+        auto pixel = queue.front();
+        queue.pop_front();
+        result.at<uchar>(pixel.first, pixel.second) = 255;
+        for (int di = -1; di <= 1; di++) {
+            for (int dj = -1; dj <= 1; dj++) {
+                int i = pixel.first + di, j = pixel.second + dj;
+                if (i >= 0 && i < rows && j >= 0 && j < cols && classes[i * cols + j] == 1) {
+                    classes[i * cols + j] = 2;
+                    queue.emplace_back(i, j);
+                }
+            }
+        }
+    }
+    return result;
+}
+
+// shapes with edges in every direction over a ramp, with noise
+cv::Mat testImage(int rows, int cols) {
+    cv::Mat image(rows, cols, CV_8UC1);
+    cv::Mat noise(rows, cols, CV_8UC1);
+    cv::randu(noise, 0, 21);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            int value = 50 + 50 * j / cols;
+            if (i > rows / 8 && i < rows / 2 && j > cols / 8 && j < cols / 3) value = 180;
+            if ((i - 2 * rows / 3) * (i - 2 * rows / 3) + (j - 2 * cols / 3) * (j - 2 * cols / 3) < rows * rows / 20) value = 20;
+            if (std::abs((i - rows / 2) - (j - cols / 2)) < 4 && i < rows / 3) value = 230;
+            image.at<uchar>(i, j) = cv::saturate_cast<uchar>(value + noise.at<uchar>(i, j) - 10);
+        }
+    }
+    return image;
+}
+
+double milliseconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main() {
+    int failures = 0;
+
+    // the fused pipeline against the reference; float rounding may flip a few pixels near
+    // the thresholds or on plateaus
+    for (auto& shape : std::vector<cv::Size>{ {1, 1}, {5, 2}, {64, 33}, {320, 240} }) {
+        cv::Mat image = testImage(shape.height, shape.width);
+        for (double sigma : { 0.8, 1.4, 2.5 }) {
+            cv::Mat fast = canny(image, 20, 60, sigma);
+            cv::Mat reference = referenceCanny(image, 20, 60, sigma);
+            int differ = 0, edges = 0;
+            for (int i = 0; i < image.rows; i++) {
+                for (int j = 0; j < image.cols; j++) {
+                    differ += fast.at<uchar>(i, j) != reference.at<uchar>(i, j);
+                    edges += reference.at<uchar>(i, j) != 0;
+                }
+            }
+            bool failed = differ > edges / 100;
+            std::cout << (failed ? "[FAIL] " : "[OK]   ") << shape.width << "x" << shape.height << " sigma=" << sigma
+                      << ": " << edges << " edge pixels, " << differ << " differ from the reference" << std::endl;
+            failures += failed;
+        }
+    }
+
+    // a clean step: one-pixel-wide edges along the border of the square, nothing elsewhere
+    cv::Mat square(100, 100, CV_8UC1, cv::Scalar(40));
+    for (int i = 30; i < 70; i++) {
+        for (int j = 30; j < 70; j++) square.at<uchar>(i, j) = 200;
+    }
+    cv::Mat edges = canny(square, 50, 150);
+    int misplaced = 0, missing = 0;
+    for (int i = 0; i < 100; i++) {
+        for (int j = 0; j < 100; j++) {
+            bool nearBorder = (i >= 28 && i <= 71 && j >= 28 && j <= 71) && !(i >= 32 && i <= 67 && j >= 32 && j <= 67);
+            misplaced += edges.at<uchar>(i, j) && !nearBorder;
+        }
+    }
+    for (int k = 35; k < 65; k++) {
+        // exactly one edge pixel across each side
+        int across[4] = { 0, 0, 0, 0 };
+        for (int d = 25; d < 35; d++) {
+            across[0] += edges.at<uchar>(d, k) != 0;
+            across[1] += edges.at<uchar>(99 - d, k) != 0;
+            across[2] += edges.at<uchar>(k, d) != 0;
+            across[3] += edges.at<uchar>(k, 99 - d) != 0;
+        }
+        for (int count : across) missing += count != 1;
+    }
+    if (misplaced || missing) {
+        std::cout << "[FAIL] square: " << misplaced << " misplaced edge pixels, " << missing << " sides not one pixel wide" << std::endl;
+        failures++;
+    }
+
+    // ms per megapixel of the fused pipeline and of the separate Kernel::conv calls it replaces
+    cv::Mat large = testImage(1080, 1920);
+    double megapixels = large.rows * large.cols / 1e6;
+    Kernel gaussian(9, 1), sobelH(5, 0), sobelV(6, 0);
+    canny(large, 20, 60);
+    auto start = std::chrono::steady_clock::now();
+    for (int k = 0; k < 5; k++) canny(large, 20, 60);
+    double fused = milliseconds(start) / 5 / megapixels;
+    start = std::chrono::steady_clock::now();
+    for (int k = 0; k < 5; k++) {
+        cv::Mat smoothed = gaussian.conv(large);
+        cv::Mat h = sobelH.conv(smoothed), v = sobelV.conv(smoothed);
+        cv::Mat thresholded(large.rows, large.cols, CV_8UC1);
+        for (int i = 0; i < large.rows; i++) {
+            for (int j = 0; j < large.cols; j++) {
+                double x = h.at<uchar>(i, j), y = v.at<uchar>(i, j);
+                thresholded.at<uchar>(i, j) = (std::sqrt(x * x + y * y) > 60) ? 255 : 0;
+            }
+        }
+    }
+    double separate = milliseconds(start) / 5 / megapixels;
+    std::cout << "canny: " << fused << " ms/megapixel, separate Gaussian + Sobel calls and threshold: "
+              << separate << " ms/megapixel" << std::endl;
+
+    std::cout << (failures ? "[FAILED]" : "[PASSED]") << " Canny edge detection" << std::endl;
+    return failures != 0;
+}
@@ -0,0 +1,503 @@
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <type_traits>
+#include "freqfilt.h"
+#include "parallel.h"
+
+// direct DFT with the sign convention of fft: exp(+2 pi i j k / n) forward
+std::vector<cd> dft(const std::vector<cd>& seq, bool invert) {
+    int n = seq.size();
+    std::vector<cd> res(n);
+    for (int k = 0; k < n; k++) {
+        cd sum = 0;
+        for (int j = 0; j < n; j++) {
+            double angle = 2 * PI * static_cast<double>((static_cast<long long>(j) * k) % n) / n * (invert ? -1 : 1);
+            sum += seq[j] * cd(cos(angle), sin(angle));
+        }
+        res[k] = invert ? sum / static_cast<double>(n) : sum;
+    }
+    return res;
+}
+
+// largest absolute difference between two sequences, relative to the largest magnitude
+double relativeError(const std::vector<cd>& a, const std::vector<cd>& b) {
+    double error = 0, scale = 1e-300;
+    for (size_t i = 0; i < a.size(); i++) {
+        error = std::max(error, std::abs(a[i] - b[i]));
+        scale = std::max(scale, std::abs(b[i]));
+    }
+    return error / scale;
+}
+
+std::vector<cd> randomSequence(int n) {
+    std::vector<cd> seq(n);
+    for (auto& x : seq) x = cd(rand() / (double)RAND_MAX - 0.5, rand() / (double)RAND_MAX - 0.5);
+    return seq;
+}
+
+CMatrix randomMatrix(int rows, int cols) {
+    CMatrix mat(rows, cols);
+    for (int i = 0; i < rows; i++) {
+        std::vector<cd> row = randomSequence(cols);
+        std::copy(row.begin(), row.end(), mat[i]);
+    }
+    return mat;
+}
+
+// the first `count` elements of row `i`
+std::vector<cd> rowOf(const CMatrix& mat, int i, int count) {
+    return std::vector<cd>(mat[i], mat[i] + count);
+}
+
+double milliseconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main() {
+    const double TOLERANCE = 1e-10;
+    int failures = 0;
+
+    // every length up to 130 (powers of two, 7-smooth and Bluestein lengths) and a few larger ones
+    std::vector<int> lengths;
+    for (int n = 1; n <= 130; n++) lengths.push_back(n);
+    for (int n : { 243, 625, 750, 1000, 1009, 2401, 4096, 4999 }) lengths.push_back(n);
+    for (int n : lengths) {
+        std::vector<cd> seq = randomSequence(n);
+        for (bool invert : { false, true }) {
+            std::vector<cd> fast = seq;
+            fft(fast, invert);
+            double error = relativeError(fast, dft(seq, invert));
+            if (error > TOLERANCE) {
+                std::cout << "[FAIL] length " << n << (invert ? " inverse" : " forward") << ": relative error " << error << std::endl;
+                failures++;
+            }
+        }
+        std::vector<cd> roundTrip = seq;
+        fft(roundTrip, false);
+        fft(roundTrip, true);
+        if (relativeError(roundTrip, seq) > TOLERANCE) {
+            std::cout << "[FAIL] length " << n << ": round trip" << std::endl;
+            failures++;
+        }
+    }
+
+    // rectangular 2-D transforms against row and column DFTs
+    for (auto shape : { std::make_pair(1, 7), std::make_pair(6, 10), std::make_pair(12, 7), std::make_pair(11, 16), std::make_pair(30, 45), std::make_pair(37, 37) }) {
+        int rows = shape.first, cols = shape.second;
+        CMatrix mat = randomMatrix(rows, cols), expected = mat;
+        for (int i = 0; i < rows; i++) {
+            std::vector<cd> row = dft(rowOf(expected, i, cols), false);
+            std::copy(row.begin(), row.end(), expected[i]);
+        }
+        for (int j = 0; j < cols; j++) {
+            std::vector<cd> column(rows);
+            for (int i = 0; i < rows; i++) column[i] = expected[i][j];
+            column = dft(column, false);
+            for (int i = 0; i < rows; i++) expected[i][j] = column[i];
+        }
+        CMatrix fast = mat;
+        fft(fast, false);
+        double error = 0;
+        for (int i = 0; i < rows; i++) error = std::max(error, relativeError(rowOf(fast, i, cols), rowOf(expected, i, cols)));
+        fft(fast, true);
+        for (int i = 0; i < rows; i++) error = std::max(error, relativeError(rowOf(fast, i, cols), rowOf(mat, i, cols)));
+        if (error > TOLERANCE) {
+            std::cout << "[FAIL] " << rows << "x" << cols << " transform: relative error " << error << std::endl;
+            failures++;
+        }
+
+        // the zero frequency moves to (rows / 2, cols / 2), and the transpose swaps the shape
+        CMatrix shifted = mat;
+        fftshift(shifted);
+        transpose(shifted);
+        bool ok = shifted.rows() == cols && shifted.cols() == rows;
+        for (int i = 0; ok && i < rows; i++) {
+            for (int j = 0; j < cols; j++) ok &= shifted[(j + cols / 2) % cols][(i + rows / 2) % rows] == mat[i][j];
+        }
+        if (!ok) {
+            std::cout << "[FAIL] " << rows << "x" << cols << " fftshift and transpose" << std::endl;
+            failures++;
+        }
+    }
+
+    // filters centred on rectangular spectra
+    CMatrix filter(5, 8);
+    gaussian(filter, 2);
+    if (filter[2][4] != cd(1, 1) || filter[2][3] != filter[2][5] || filter[1][4] != filter[3][4]) {
+        std::cout << "[FAIL] gaussian filter on a 5x8 spectrum is not centred at (2, 4)" << std::endl;
+        failures++;
+    }
+
+    // real masks mirrored from one quadrant, against the gains evaluated at every element
+    for (auto shape : { std::make_pair(5, 8), std::make_pair(9, 6), std::make_pair(16, 16), std::make_pair(1, 7) }) {
+        int rows = shape.first, cols = shape.second;
+        double error = 0;
+        for (bool high : { false, true }) {
+            FilterMask masks[] = { FilterMask(MASK_IDEAL, rows, cols, 2.5, 1, high),
+                                   FilterMask(MASK_GAUSSIAN, rows, cols, 2.5, 1, high),
+                                   FilterMask(MASK_BUTTERWORTH, rows, cols, 2.5, 3, high) };
+            for (int i = 0; i < rows; i++) {
+                for (int j = 0; j < cols; j++) {
+                    double dist = (i - rows / 2) * (i - rows / 2) + (j - cols / 2) * (j - cols / 2);
+                    double gains[] = { dist < 6.25 ? 1.0 : 0.0, exp(-dist / 6.25 * 2), 1 / (1 + pow(dist / 6.25, 3)) };
+                    for (int t = 0; t < 3; t++) error = std::max(error, std::abs(masks[t][i][j] - (high ? 1 - gains[t] : gains[t])));
+                }
+            }
+        }
+        if (error > TOLERANCE) {
+            std::cout << "[FAIL] " << rows << "x" << cols << " filter masks: error " << error << std::endl;
+            failures++;
+        }
+    }
+
+    // masks are built once per setting; the order does not matter to ideal and gaussian masks
+    auto cached = FilterMask::get(MASK_GAUSSIAN, 64, 48, 10);
+    if (FilterMask::get(MASK_GAUSSIAN, 64, 48, 10, 3) != cached || FilterMask::get(MASK_GAUSSIAN, 64, 48, 10, 1, true) == cached ||
+        FilterMask::get(MASK_BUTTERWORTH, 64, 48, 10, 2) == FilterMask::get(MASK_BUTTERWORTH, 64, 48, 10, 3)) {
+        std::cout << "[FAIL] filter mask cache" << std::endl;
+        failures++;
+    }
+
+    // real transforms against the complex ones, in 1-D for every length up to 130 and in 2-D
+    for (int n : lengths) {
+        std::vector<double> seq(n);
+        for (auto& x : seq) x = rand() / (double)RAND_MAX - 0.5;
+        std::vector<cd> full(seq.begin(), seq.end()), half;
+        fft(full, false);
+        rfft(seq, half);
+        full.resize(n / 2 + 1);
+        std::vector<double> back(n);
+        irfft(half, back);
+        double error = relativeError(half, full);
+        for (int j = 0; j < n; j++) error = std::max(error, std::abs(back[j] - seq[j]));
+        if (error > TOLERANCE) {
+            std::cout << "[FAIL] real transform of length " << n << ": error " << error << std::endl;
+            failures++;
+        }
+    }
+    for (auto shape : { std::make_pair(1, 1), std::make_pair(6, 10), std::make_pair(12, 7), std::make_pair(11, 16), std::make_pair(30, 45) }) {
+        int rows = shape.first, cols = shape.second;
+        RMatrix mat(rows, cols);
+        CMatrix full(rows, cols), half;
+        for (int i = 0; i < rows; i++) {
+            for (int j = 0; j < cols; j++) full[i][j] = mat[i][j] = rand() / (double)RAND_MAX;
+        }
+        fft(full, false);
+        rfft(mat, half);
+        double error = 0;
+        for (int i = 0; i < rows; i++) {
+            error = std::max(error, relativeError(rowOf(half, i, cols / 2 + 1), rowOf(full, i, cols / 2 + 1)));
+            error = std::max(error, relativeError(rowOf(fullSpectrum(half, cols), i, cols), rowOf(full, i, cols)));
+        }
+
+        // a centred filter applied to the half spectrum, against the fftshift-ed full spectrum
+        CMatrix filter(rows, cols);
+        butterworth(filter, 3, 2);
+        fftshift(full);
+        for (int i = 0; i < rows; i++) {
+            for (int j = 0; j < cols; j++) full[i][j] = dot(full[i][j], filter[i][j]);
+        }
+        // undoing the shift before the inverse transform
+        std::rotate(full.data(), full.data() + rows / 2 * cols, full.data() + rows * cols);
+        for (int i = 0; i < rows; i++) std::rotate(full[i], full[i] + cols / 2, full[i] + cols);
+        fft(full, true);
+        CMatrix masked = half;
+        applyFilter(half, filter);
+        applyFilter(masked, *FilterMask::get(MASK_BUTTERWORTH, rows, cols, 3, 2));
+        for (int i = 0; i < rows; i++) error = std::max(error, relativeError(rowOf(masked, i, cols / 2 + 1), rowOf(half, i, cols / 2 + 1)));
+        RMatrix back;
+        irfft(half, back, cols);
+        for (int i = 0; i < rows; i++) {
+            for (int j = 0; j < cols; j++) error = std::max(error, std::abs(back[i][j] - full[i][j].real()));
+        }
+        if (error > TOLERANCE) {
+            std::cout << "[FAIL] " << rows << "x" << cols << " real transform and filtering: error " << error << std::endl;
+            failures++;
+        }
+    }
+
+    // matrices are one aligned buffer of consecutive rows, whose memory is kept when they shrink
+    CMatrix mat = randomMatrix(20, 30);
+    const cd* buffer = mat.data();
+    bool contiguous = reinterpret_cast<uintptr_t>(buffer) % CMatrix::ALIGNMENT == 0 && mat[7] == buffer + 7 * 30;
+    mat.reset(30, 20);
+    if (!contiguous || mat.data() != buffer || mat[29][19] != cd(0) || CMatrix(mat).data() == buffer) {
+        std::cout << "[FAIL] complex matrix layout" << std::endl;
+        failures++;
+    }
+    // and so are the real ones, readReal included
+    RMatrixF levels = readReal<float>(cv::Mat(20, 30, CV_8UC1, cv::Scalar(51)));
+    const float* first = levels.data();
+    if (reinterpret_cast<uintptr_t>(first) % RMatrixF::ALIGNMENT != 0 || levels[7] != first + 7 * 30 || levels[19][29] != 0.2f) {
+        std::cout << "[FAIL] real matrix layout" << std::endl;
+        failures++;
+    }
+
+    // the float transforms against the double ones, within the documented bounds
+    for (int n : lengths) {
+        std::vector<cd> seq = randomSequence(n), expected = seq;
+        std::vector<cf> single(seq.begin(), seq.end());
+        double bound = 6e-8 * (log2(n) + 1);
+        fft(expected, false);
+        fft(single, false);
+        double error = relativeError(std::vector<cd>(single.begin(), single.end()), expected);
+        fft(single, true);
+        double roundTrip = relativeError(std::vector<cd>(single.begin(), single.end()), seq);
+        if (error > bound || roundTrip > 2 * bound) {
+            std::cout << "[FAIL] float transform of length " << n << ": relative error " << error << ", round trip " << roundTrip << std::endl;
+            failures++;
+        }
+    }
+
+    // the kernels of every instruction set the CPU supports against the scalar ones, in both
+    // precisions and directions; wide lanes may fuse a multiply and an add, so they agree to
+    // within rounding rather than bit for bit
+    if (FftPlan::get(64, false)->instructionSet() != fftBestIsa() || !fftIsaSupported(FFT_SCALAR)) {
+        std::cout << "[FAIL] plans do not default to the widest supported instruction set" << std::endl;
+        failures++;
+    }
+    std::vector<int> isaLengths = lengths;
+    for (int n : { 1024, 2048, 3072, 4096, 6000 }) isaLengths.push_back(n);
+    for (FftIsa isa : { FFT_SSE2, FFT_AVX2, FFT_AVX512 }) {
+        if (!fftIsaSupported(isa)) {
+            std::cout << "instruction set " << isa << " not supported here, skipped" << std::endl;
+            continue;
+        }
+        for (int n : isaLengths) {
+            for (bool invert : { false, true }) {
+                std::vector<cd> seq = randomSequence(n), expected = seq;
+                std::vector<cf> single(seq.begin(), seq.end()), singleExpected = single;
+                FftPlan(n, invert, isa).execute(seq);
+                FftPlan(n, invert, FFT_SCALAR).execute(expected);
+                FftPlanF(n, invert, isa).execute(single);
+                FftPlanF(n, invert, FFT_SCALAR).execute(singleExpected);
+                double error = relativeError(seq, expected);
+                double singleError = relativeError(std::vector<cd>(single.begin(), single.end()),
+                                                   std::vector<cd>(singleExpected.begin(), singleExpected.end()));
+                if (error > 1e-15 * (log2(n) + 1) || singleError > 6e-8 * (log2(n) + 1)) {
+                    std::cout << "[FAIL] instruction set " << isa << ", length " << n << (invert ? " inverse" : "")
+                              << ": relative error " << error << " (double), " << singleError << " (float)" << std::endl;
+                    failures++;
+                }
+            }
+        }
+    }
+
+    // an 8-bit image low-pass filtered in float and in double, at most one grey level apart
+    cv::Mat grey(240, 320, CV_8UC1), low[2];
+    for (int i = 0; i < grey.rows; i++) {
+        for (int j = 0; j < grey.cols; j++) grey.at<uchar>(i, j) = static_cast<uchar>(rand() % 256);
+    }
+    auto lowPass = [&](auto spectrum, cv::Mat& output) {
+        decltype(spectrum) filter(grey.rows, grey.cols);
+        gaussian(filter, 40);
+        fft(spectrum, false);
+        fftshift(spectrum);
+        for (int i = 0; i < grey.rows; i++) {
+            for (int j = 0; j < grey.cols; j++) spectrum[i][j] *= filter[i][j].real();
+        }
+        fftshift(spectrum); // even sizes, so shifting twice is the identity
+        fft(spectrum, true);
+        output = grey.clone();
+        writeVector(output, spectrum, false);
+    };
+    lowPass(readVector(grey), low[0]);
+    lowPass(readVector<float>(grey), low[1]);
+    int worst = 0;
+    for (int i = 0; i < grey.rows; i++) {
+        for (int j = 0; j < grey.cols; j++) worst = std::max(worst, std::abs(low[0].at<uchar>(i, j) - low[1].at<uchar>(i, j)));
+    }
+    if (worst > 1) {
+        std::cout << "[FAIL] float filtering differs from double by " << worst << " grey levels" << std::endl;
+        failures++;
+    }
+
+    // and through the half spectrum of the real transforms, from readReal to writeReal
+    auto halfLowPass = [&](auto real, cv::Mat& output) {
+        using T = std::remove_pointer_t<decltype(real.data())>;
+        BasicCMatrix<T> half, filter(grey.rows, grey.cols);
+        gaussian(filter, 40);
+        rfft(real, half);
+        applyFilter(half, filter);
+        irfft(half, real, grey.cols);
+        output = grey.clone();
+        writeReal(output, real);
+    };
+    halfLowPass(readReal(grey), low[0]);
+    halfLowPass(readReal<float>(grey), low[1]);
+    worst = 0;
+    for (int i = 0; i < grey.rows; i++) {
+        for (int j = 0; j < grey.cols; j++) worst = std::max(worst, std::abs(low[0].at<uchar>(i, j) - low[1].at<uchar>(i, j)));
+    }
+    if (worst > 1) {
+        std::cout << "[FAIL] float real-transform filtering differs from double by " << worst << " grey levels" << std::endl;
+        failures++;
+    }
+
+    // padded sizes: never shorter, handled without Bluestein's algorithm, and never costlier than
+    // the next power of two, in 1-D and in 2-D
+    auto smooth = [](int n) {
+        for (int radix : { 2, 3, 5, 7 }) {
+            while (n % radix == 0) n /= radix;
+        }
+        return n == 1;
+    };
+    auto powerOfTwo = [](int n) {
+        int p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    };
+    int badSizes = 0;
+    for (int n = 1; n <= 3000; n += 7) {
+        int size = fftSize(n);
+        badSizes += size < n || !smooth(size) || fftCost(size) > fftCost(powerOfTwo(n));
+        for (int m : { 1, 77, 480, 750 }) {
+            std::pair<int, int> shape = fftSize(n, m);
+            badSizes += shape.first < n || shape.second < m || !smooth(shape.first) || !smooth(shape.second)
+                      || fftCost(shape.first, shape.second) > fftCost(powerOfTwo(n), powerOfTwo(m));
+        }
+    }
+    if (badSizes) {
+        std::cout << "[FAIL] " << badSizes << " padded sizes are shorter, not 7-smooth or costlier than a power of two" << std::endl;
+        failures++;
+    }
+
+    // plans are shared per length and direction, and every thread gets the same one even when requested concurrently
+    auto plan = FftPlan::get(4096, false);
+    if (FftPlan::get(4096, false) != plan || FftPlan::get(4096, true) == plan || plan->size() != 4096 || plan->inverse()) {
+        std::cout << "[FAIL] plan registry does not return one plan per length and direction" << std::endl;
+        failures++;
+    }
+    std::vector<std::shared_ptr<const FftPlan>> plans(4);
+    std::vector<double> errors(4);
+    std::vector<cd> seq = randomSequence(3001), expected = dft(seq, false);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&, t] {
+            plans[t] = FftPlan::get(3001, false);
+            std::vector<cd> fast = seq;
+            plans[t]->execute(fast);
+            errors[t] = relativeError(fast, expected);
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    for (int t = 0; t < 4; t++) {
+        if (plans[t] != plans[0] || errors[t] > TOLERANCE) {
+            std::cout << "[FAIL] concurrent plan of length 3001: relative error " << errors[t] << std::endl;
+            failures++;
+        }
+    }
+
+    // a pure tone of a large transform lands in a single bin; twiddles read from the tables keep
+    // the error at rounding level, where a running product would grow with the length
+    for (int n : { 1 << 18, 3 * (1 << 16), 5 * 5 * 5 * 7 * 7 * 7 * 4 }) {
+        int frequency = n / 3 + 1;
+        std::vector<cd> tone(n), peak(n, cd(0));
+        for (int j = 0; j < n; j++) {
+            double angle = -2 * PI * static_cast<double>((static_cast<long long>(j) * frequency) % n) / n;
+            tone[j] = cd(cos(angle), sin(angle));
+        }
+        peak[frequency] = n;
+        std::vector<cd> fast = tone;
+        FftPlan::get(n, false)->execute(fast);
+        double error = relativeError(fast, peak);
+        FftPlan::get(n, true)->execute(fast);
+        error = std::max(error, relativeError(fast, tone));
+        if (error > 1e-12) {
+            std::cout << "[FAIL] tone of length " << n << ": relative error " << error << std::endl;
+            failures++;
+        }
+    }
+
+    // the 2-D transforms and the transposition give the same bits on any number of threads
+    std::vector<CMatrix> results[2];
+    RMatrix samples(300, 500), back[2];
+    for (int i = 0; i < 300 * 500; i++) samples.data()[i] = rand() / (double)RAND_MAX;
+    CMatrix source = randomMatrix(300, 500);
+    for (int run = 0; run < 2; run++) {
+        setNumThreads(run ? 4 : 1);
+        CMatrix forward = source, square(300, 300), half;
+        fft(forward, false);
+        std::copy(forward.data(), forward.data() + 300 * 300, square.data());
+        transpose(forward);
+        transpose(square);
+        rfft(samples, half);
+        results[run] = { forward, square, half };
+        irfft(half, back[run], 500);
+    }
+    setNumThreads(0);
+    bool identical = std::equal(back[0].data(), back[0].data() + 300 * 500, back[1].data());
+    for (int k = 0; k < 3; k++) {
+        const CMatrix& a = results[0][k];
+        const CMatrix& b = results[1][k];
+        identical &= a.rows() == b.rows() && a.cols() == b.cols()
+            && std::equal(a.data(), a.data() + a.rows() * a.cols(), b.data());
+    }
+    if (!identical) {
+        std::cout << "[FAIL] 2-D transforms differ between 1 and 4 threads" << std::endl;
+        failures++;
+    }
+
+    // repeated transforms of one length, which only look up their plan
+    std::vector<cd> small = randomSequence(4096);
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < 1000; r++) fft(small, r % 2 == 1);
+    std::cout << "1000 transforms of length 4096: " << milliseconds(start) << " ms" << std::endl;
+
+    // the cost of transforming a 1000 x 750 image at its size, against padding to 1024 x 1024
+    CMatrix image = randomMatrix(1000, 750), padded = randomMatrix(1024, 1024);
+    start = std::chrono::steady_clock::now();
+    fft(image, false);
+    double exact = milliseconds(start);
+    start = std::chrono::steady_clock::now();
+    fft(padded, false);
+    double power = milliseconds(start);
+    std::cout << "1000x750 transform: " << exact << " ms, padded to 1024x1024: " << power << " ms" << std::endl;
+
+    // the shape that fftSize picks for 1008 x 756, against the next power of two
+    std::pair<int, int> shape = fftSize(1008, 756);
+    CMatrix chosen = randomMatrix(shape.first, shape.second);
+    start = std::chrono::steady_clock::now();
+    fft(chosen, false);
+    std::cout << "1008x756 padded to " << shape.first << "x" << shape.second << ": " << milliseconds(start)
+              << " ms, to 1024x1024: " << power << " ms" << std::endl;
+
+    // the 2-D transform on one thread against the whole pool
+    CMatrix large = randomMatrix(2048, 2048);
+    setNumThreads(1);
+    start = std::chrono::steady_clock::now();
+    fft(large, false);
+    double serial = milliseconds(start);
+    setNumThreads(0);
+    start = std::chrono::steady_clock::now();
+    fft(large, true);
+    std::cout << "2048x2048 transform: " << serial << " ms on 1 thread, " << milliseconds(start) << " ms on "
+              << getNumThreads() << std::endl;
+
+    // the float transform against the double one, on the same size
+    CMatrixF single(1024, 1024);
+    start = std::chrono::steady_clock::now();
+    fft(single, false);
+    std::cout << "1024x1024 float transform: " << milliseconds(start) << " ms, double: " << power << " ms" << std::endl;
+
+    // the real transform against the complex one, on the same image
+    RMatrix real(1024, 1024);
+    std::fill(real.data(), real.data() + 1024 * 1024, 0.5);
+    CMatrix half;
+    start = std::chrono::steady_clock::now();
+    rfft(real, half);
+    std::cout << "1024x1024 real transform: " << milliseconds(start) << " ms, complex: " << power << " ms" << std::endl;
+
+
+    // building a butterworth mask against fetching it again, as a slider moving back does
+    start = std::chrono::steady_clock::now();
+    FilterMask::get(MASK_BUTTERWORTH, 1024, 1024, 100, 2);
+    double build = milliseconds(start);
+    start = std::chrono::steady_clock::now();
+    FilterMask::get(MASK_BUTTERWORTH, 1024, 1024, 100, 2);
+    std::cout << "1024x1024 butterworth mask: " << build << " ms, cached: " << milliseconds(start) << " ms" << std::endl;
+
+    std::cout << (failures ? "[FAILED]" : "[PASSED]") << " mixed-radix, Bluestein, rectangular, real, float and multithreaded FFT, FFT plans, complex matrices and filter masks" << std::endl;
+    return failures != 0;
+}
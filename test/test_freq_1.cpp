@@ -1,4 +1,5 @@
 #include "filt.h"
+#include "sweep.h"
 
 int fileName = 0;
 int filterType = 0;
@@ -73,21 +74,10 @@ void onInputChange(int, void*) {
 }
 
 // automated filtering of all the files with every possible filter
+// prints the timing table of every combination and writes the outputs next to the GUI results
 void automatic() {
-    std::vector<int> validFileNames, validFilterTypes, validFilterSize;
-    for (int i = 0; i < fileList.size(); i++) validFileNames.push_back(i);
-    for (int i = 0; i < 11; i++) validFilterTypes.push_back(i);
-    for (int i = 0; i < 4; i++) validFilterSize.push_back(i);
-    for (int x : validFileNames) {
-        fileName = x;
-        for (int y : validFilterTypes) {
-            filterType = y;
-            for (int z : validFilterSize) {
-                filterSize = z;
-                onSizeChange(0, 0);
-            }
-        }
-    }
+    std::string outputDirectory = "C:\\Users\\Utkarsh\\Documents\\acads\\assignments\\image-proc\\img\\filtering\\results";
+    printSweep(std::cout, sweep(fileList, outputDirectory), fileList);
 }
 
 int main() {
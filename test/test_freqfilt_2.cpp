@@ -51,45 +51,41 @@ void onChange(int, void*) {
     }
 
     cv::imshow("[S] Input", image);
-    auto matrix = readVector(image);               // reading values into 2-D vector `matrix`
-    fft(matrix, false);                            // performing FFT over the image
+    auto samples = readReal(image);                // reading values into real matrix `samples`
+    CMatrix half;
+    rfft(samples, half);                           // performing FFT over the image, half spectrum
+    auto matrix = fullSpectrum(half, image.cols);  // full spectrum, only for display
     fftshift(matrix);
     cv::Mat inputSpectrum = image.clone();
     writeVector(inputSpectrum, matrix); // computing magnitude spectrum
     cv::imshow("[F] Input", inputSpectrum);
 
     // selecting filter
-    int n = matrix.size();
-    std::vector<std::vector<cd>> filter(n, std::vector<cd>(n));
+    int n = image.rows;
+    int m = image.cols;
     int filterType_ = (filterType >> 1);
     bool high = filterType % 2;
     int threshold_ = (1 << (threshold << 1)) - 1;
+    MaskType types[] = { MASK_IDEAL, MASK_GAUSSIAN, MASK_BUTTERWORTH };
 
-    if (filterType_ == 0) {
-        ideal(filter, threshold_, order + 1, high);
-    }
-    else if (filterType_ == 1) {
-        gaussian(filter, threshold_, order + 1, high);
-    }
-    else {
-        butterworth(filter, threshold_, order + 1, high);
-    }
+    // cached, so moving a slider back to earlier settings does not evaluate the mask again
+    auto filter = FilterMask::get(types[filterType_], n, m, threshold_, order + 1, high);
     cv::Mat filterSpectrum = image.clone();
-    writeVector(filterSpectrum, filter); // magnitude spectrum of filter
+    writeMask(filterSpectrum, *filter); // gains of filter
     cv::imshow("[F] Filter", filterSpectrum);
 
-    // applying filter
-    for (int i = 0; i < n; i++) for (int j = 0; j < n; j++) {
-        matrix[i][j] = dot(matrix[i][j], filter[i][j]);
-    }
+    // applying filter over the half spectrum
+    applyFilter(half, *filter);
+    matrix = fullSpectrum(half, m);
+    fftshift(matrix);
     cv::Mat outputSpectrum = image.clone();
     writeVector(outputSpectrum, matrix); // magnitude spectrum of output
     cv::imshow("[F] Output", outputSpectrum);
 
     // performing IFFT to get filtered output image
-    fft(matrix, true);
+    irfft(half, samples, m);
     cv::Mat outputImage = image.clone();
-    writeVector(outputImage, matrix, false);
+    writeReal(outputImage, samples);
     cv::imshow("[S] Output", outputImage);
 
     std::string message = "[Done!] filter=" + FILTER_NAME[filterType] + ", ";
@@ -0,0 +1,133 @@
+#include <chrono>
+#include "filt.h"
+
+int failures = 0;
+
+void expect(bool ok, const std::string& what) {
+    if (!ok) {
+        std::cout << "[FAIL] " << what << std::endl;
+        failures++;
+    }
+}
+
+// convolution with the sampled Gaussian of `sigma`, normalized to a unit sum and cut at 4 sigma,
+// along rows then columns, with the borders extended by their edge values
+cv::Mat referenceGaussian(const cv::Mat& image, double sigma) {
+    int radius = static_cast<int>(ceil(4 * sigma));
+    std::vector<double> taps(2 * radius + 1);
+    double sum = 0;
+    for (int k = -radius; k <= radius; k++) sum += taps[k + radius] = exp(-k * k / (2 * sigma * sigma));
+    for (auto& tap : taps) tap /= sum;
+    int rows = image.rows, cols = image.cols;
+    std::vector<double> horizontal(rows * cols);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            double pixel = 0;
+            for (int k = -radius; k <= radius; k++) pixel += taps[k + radius] * image.at<uchar>(i, std::min(std::max(j + k, 0), cols - 1));
+            horizontal[i * cols + j] = pixel;
+        }
+    }
+    cv::Mat result(rows, cols, CV_64FC1);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            double pixel = 0;
+            for (int k = -radius; k <= radius; k++) pixel += taps[k + radius] * horizontal[std::min(std::max(i + k, 0), rows - 1) * cols + j];
+            result.at<double>(i, j) = pixel;
+        }
+    }
+    return result;
+}
+
+// derivative of order `dx` along rows and `dy` along columns of `smooth`, by central differences
+// with the borders extended by their edge values
+double derivative(const cv::Mat& smooth, int i, int j, int dx, int dy) {
+    auto at = [&](int x, int y) {
+        return smooth.at<double>(std::min(std::max(x, 0), smooth.rows - 1), std::min(std::max(y, 0), smooth.cols - 1));
+    };
+    if (dx == 1) return (at(i, j + 1) - at(i, j - 1)) * 0.5;
+    if (dx == 2) return at(i, j + 1) - 2 * at(i, j) + at(i, j - 1);
+    if (dy == 1) return (at(i + 1, j) - at(i - 1, j)) * 0.5;
+    if (dy == 2) return at(i + 1, j) - 2 * at(i, j) + at(i - 1, j);
+    return at(i, j);
+}
+
+// best of several runs of recursiveGaussian, in nanoseconds per pixel
+double timePerPixel(const cv::Mat& image, double sigma) {
+    double best = 1e300;
+    for (int run = 0; run < 5; run++) {
+        auto start = std::chrono::steady_clock::now();
+        recursiveGaussian(image, sigma);
+        best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best / image.total();
+}
+
+int main() {
+    // smooth waves over a checkerboard of steps, so that both slopes and edges are compared;
+    // 300 rows are enough for sigma 30 to reach both borders from the middle
+    cv::Mat image(300, 280, CV_8UC1);
+    for (int i = 0; i < image.rows; i++) {
+        for (int j = 0; j < image.cols; j++) {
+            image.at<uchar>(i, j) = static_cast<uchar>(128 + 100 * sin(i * 0.05) * cos(j * 0.07) + ((i / 40 + j / 40) % 2) * 20);
+        }
+    }
+
+    // the Young - van Vliet filter approximates the Gaussian to 1% of the image range, borders
+    // included; its derivatives are the central differences of that approximation, so their
+    // bounds in grey levels follow from it, by order of derivative
+    const double BOUND[] = { 2.55, 1.0, 1.5 };
+    int orders[][2] = { { 0, 0 }, { 1, 0 }, { 0, 1 }, { 2, 0 }, { 0, 2 } };
+    for (double sigma : { 1.0, 5.0, 30.0 }) {
+        cv::Mat reference = referenceGaussian(image, sigma);
+        for (auto& order : orders) {
+            int dx = order[0], dy = order[1];
+            cv::Mat result = recursiveGaussian(image, sigma, dx, dy);
+            double worst = 0;
+            for (int i = 0; i < image.rows; i++) {
+                for (int j = 0; j < image.cols; j++) {
+                    worst = std::max(worst, std::abs(result.at<float>(i, j) - derivative(reference, i, j, dx, dy)));
+                }
+            }
+            expect(worst <= BOUND[dx + dy], "sigma " + std::to_string(sigma) + ", dx " + std::to_string(dx) + ", dy " + std::to_string(dy)
+                                   + ": difference " + std::to_string(worst));
+        }
+    }
+
+    // a constant image stays constant up to its borders
+    cv::Mat flat(37, 23, CV_8UC1, cv::Scalar(77));
+    for (double sigma : { 1.0, 5.0, 30.0 }) {
+        cv::Mat result = recursiveGaussian(flat, sigma);
+        double worst = 0;
+        for (int i = 0; i < flat.rows; i++) {
+            for (int j = 0; j < flat.cols; j++) worst = std::max(worst, std::abs(result.at<float>(i, j) - 77.0));
+        }
+        expect(worst <= 1e-3, "constant image with sigma " + std::to_string(sigma));
+    }
+
+    // other types are rejected rather than read as floats
+    for (int type : { CV_8UC3, CV_16UC1, CV_16SC1, CV_64FC1 }) {
+        bool thrown = false;
+        try {
+            recursiveGaussian(cv::Mat(8, 8, type, cv::Scalar(0)), 2);
+        }
+        catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        expect(thrown, "recursiveGaussian accepts type " + std::to_string(type));
+    }
+
+    // the recursion does the same work for any sigma
+    cv::Mat noise(1024, 1024, CV_8UC1);
+    cv::randu(noise, 0, 256);
+    recursiveGaussian(noise, 1);
+    double fastest = 1e300, slowest = 0;
+    for (double sigma : { 1.0, 5.0, 30.0 }) {
+        double time = timePerPixel(noise, sigma);
+        fastest = std::min(fastest, time);
+        slowest = std::max(slowest, time);
+    }
+    expect(slowest <= 1.5 * fastest, "time per pixel from " + std::to_string(fastest) + " to " + std::to_string(slowest) + " ns");
+
+    std::cout << (failures ? "[FAILED]" : "[PASSED]") << " recursive Gaussian against sampled Gaussian convolution" << std::endl;
+    return failures != 0;
+}
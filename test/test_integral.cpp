@@ -0,0 +1,130 @@
+#include <cmath>
+#include <functional>
+#include <tuple>
+#include "morph.h"
+#include "parallel.h"
+
+int failures = 0;
+
+void expect(bool ok, const std::string& what) {
+    if (!ok) {
+        std::cout << "[FAIL] " << what << std::endl;
+        failures++;
+    }
+}
+
+// mean and variance of the size x size window centred at (i, j), clipped to the image, by direct summation
+void directStats(const cv::Mat& image, int i, int j, int size, double& mean, double& variance) {
+    double count = 0;
+    mean = variance = 0;
+    for (int y = std::max(i - size / 2, 0); y <= std::min(i + size / 2, image.rows - 1); y++) {
+        for (int x = std::max(j - size / 2, 0); x <= std::min(j + size / 2, image.cols - 1); x++) {
+            count++;
+            mean += image.at<uchar>(y, x);
+        }
+    }
+    mean /= count;
+    for (int y = std::max(i - size / 2, 0); y <= std::min(i + size / 2, image.rows - 1); y++) {
+        for (int x = std::max(j - size / 2, 0); x <= std::min(j + size / 2, image.cols - 1); x++) {
+            variance += (image.at<uchar>(y, x) - mean) * (image.at<uchar>(y, x) - mean);
+        }
+    }
+    variance /= count;
+}
+
+// window sums and statistics against direct summation, over random windows
+void checkStats(const cv::Mat& image) {
+    IntegralImage integral(image);
+    cv::RNG rng(7);
+    for (int t = 0; t < 2000; t++) {
+        int top = rng.uniform(0, image.rows), bottom = rng.uniform(top, image.rows) + 1;
+        int left = rng.uniform(0, image.cols), right = rng.uniform(left, image.cols) + 1;
+        uint64_t sum = 0, squares = 0;
+        for (int i = top; i < bottom; i++) {
+            for (int j = left; j < right; j++) {
+                uint64_t pixel = image.at<uchar>(i, j);
+                sum += pixel;
+                squares += pixel * pixel;
+            }
+        }
+        expect(integral.sum(top, left, bottom, right) == sum, "window sum");
+        expect(integral.sumOfSquares(top, left, bottom, right) == squares, "window sum of squares");
+
+        int i = rng.uniform(0, image.rows), j = rng.uniform(0, image.cols), size = rng.uniform(1, 16) * 2 + 1;
+        double mean, variance;
+        directStats(image, i, j, size, mean, variance);
+        double m, v;
+        integral.windowStats(i, j, size, m, v);
+        expect(std::abs(m - mean) < 1e-9 && std::abs(v - variance) < 1e-6, "window statistics");
+    }
+}
+
+int main() {
+    for (int threads : { 1, 4 }) {
+        setNumThreads(threads);
+        for (auto dims : { std::make_pair(1, 1), std::make_pair(3, 7), std::make_pair(97, 131), std::make_pair(256, 301) }) {
+            cv::Mat image(dims.first, dims.second, CV_8UC1);
+            cv::randu(image, 0, 256);
+            checkStats(image);
+        }
+
+        // 65025 * 300 * 300 overflows 32 bits
+        cv::Mat white(300, 300, CV_8UC1, cv::Scalar(255));
+        IntegralImage integral(white);
+        expect(integral.sumOfSquares(0, 0, 300, 300) == 65025ULL * 300 * 300, "64-bit sum of squares");
+
+        // thresholds against the brute-force statistics of every window, on an image where most
+        // windows are whole and on one where every window is clipped by the borders;
+        // pixels within rounding of their threshold may go either way
+        for (auto dims : { std::make_tuple(120, 90, 15), std::make_tuple(20, 13, 31) }) {
+            int size = std::get<2>(dims);
+            cv::Mat image(std::get<0>(dims), std::get<1>(dims), CV_8UC1);
+            cv::randu(image, 0, 256);
+            for (int i = 0; i < image.rows; i++) {
+                for (int j = 0; j < image.cols; j++) image.at<uchar>(i, j) = image.at<uchar>(i, j) / 2 + j; // uneven lighting
+            }
+            for (ThresholdMethod method : { ADAPTIVE_MEAN_C, ADAPTIVE_NIBLACK, ADAPTIVE_SAUVOLA }) {
+                double k = method == ADAPTIVE_MEAN_C ? 5 : method == ADAPTIVE_NIBLACK ? -0.2 : 0.2;
+                cv::Mat result = image.clone();
+                adaptiveBinary(result, method, size, k);
+                int differ = 0;
+                for (int i = 0; i < image.rows; i++) {
+                    for (int j = 0; j < image.cols; j++) {
+                        double mean, variance;
+                        directStats(image, i, j, size, mean, variance);
+                        double s = std::sqrt(variance);
+                        double threshold = method == ADAPTIVE_MEAN_C ? mean - k
+                                         : method == ADAPTIVE_NIBLACK ? mean + k * s
+                                         : mean * (1 + k * (s / SAUVOLA_RANGE - 1));
+                        if (std::abs(image.at<uchar>(i, j) - threshold) < 1e-6) continue;
+                        differ += result.at<uchar>(i, j) != ((image.at<uchar>(i, j) > threshold) ? 255 : 0);
+                    }
+                }
+                expect(differ == 0, "adaptive threshold " + std::to_string(method) + " with window " + std::to_string(size));
+            }
+        }
+    }
+
+    // only CV_8UC1 images and odd, positive window sizes are accepted
+    std::vector<std::pair<std::string, std::function<void()>>> rejected = {
+        { "IntegralImage of a CV_8UC3 image", [] { IntegralImage(cv::Mat(9, 11, CV_8UC3)); } },
+        { "IntegralImage of a CV_16SC1 image", [] { IntegralImage(cv::Mat(9, 11, CV_16SC1)); } },
+        { "adaptiveBinary of a CV_32FC1 image", [] { cv::Mat image(9, 11, CV_32FC1); adaptiveBinary(image, ADAPTIVE_MEAN_C, 5, 5); } },
+    };
+    for (int size : { 0, -3, 4 }) {
+        rejected.push_back({ "adaptiveBinary with window " + std::to_string(size),
+                             [size] { cv::Mat image(9, 11, CV_8UC1); adaptiveBinary(image, ADAPTIVE_MEAN_C, size, 5); } });
+    }
+    for (auto& call : rejected) {
+        bool thrown = false;
+        try {
+            call.second();
+        }
+        catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        expect(thrown, call.first + " is accepted");
+    }
+    std::cout << (failures ? "[FAILED]" : "[PASSED]") << " summed-area tables and adaptive thresholding" << std::endl;
+    return failures != 0;
+}
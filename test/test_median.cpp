@@ -0,0 +1,112 @@
+#include "filt.h"
+
+// reference median: sorts the in-bounds pixels of every window
+cv::Mat referenceMedian(const cv::Mat& image, int size, double percentile = 0.5) {
+    cv::Mat result = image.clone();
+    int size2 = size / 2;
+    std::vector<uchar> pixels;
+    for (int i = 0; i < image.rows; i++) {
+        for (int j = 0; j < image.cols; j++) {
+            pixels.clear();
+            for (int dx = -size2; dx <= size2; dx++) {
+                for (int dy = -size2; dy <= size2; dy++) {
+                    int nx = i + dx;
+                    int ny = j + dy;
+                    if (nx >= 0 && nx < image.rows && ny >= 0 && ny < image.cols) {
+                        pixels.push_back(image.at<uchar>(nx, ny));
+                    }
+                }
+            }
+            std::sort(pixels.begin(), pixels.end());
+            result.at<uchar>(i, j) = pixels[static_cast<int>(percentile * (pixels.size() - 1) + 0.5)];
+        }
+    }
+    return result;
+}
+
+// number of pixels in which `a` and `b` differ
+int mismatches(const cv::Mat& a, const cv::Mat& b) {
+    int count = 0;
+    for (int i = 0; i < a.rows; i++) {
+        for (int j = 0; j < a.cols; j++) {
+            count += a.at<uchar>(i, j) != b.at<uchar>(i, j);
+        }
+    }
+    return count;
+}
+
+// channel `c` of an interleaved image, as a single-channel image
+cv::Mat channel(const cv::Mat& image, int c) {
+    cv::Mat result(image.rows, image.cols, CV_8UC1);
+    for (int i = 0; i < image.rows; i++) {
+        for (int j = 0; j < image.cols; j++) {
+            result.at<uchar>(i, j) = image.ptr<uchar>(i)[j * image.channels() + c];
+        }
+    }
+    return result;
+}
+
+int main() {
+    // odd shapes exercise the border windows and the scalar tail of every SIMD row
+    std::vector<cv::Size> shapes = { {1, 1}, {4, 3}, {5, 5}, {17, 9}, {33, 31}, {100, 67}, {257, 129} };
+    std::vector<int> sizes = { 3, 5, 7, 9 };
+    std::vector<double> percentiles = { 0.5, 0.0, 0.3, 1.0 };
+    int failures = 0;
+
+    for (auto& shape : shapes) {
+        cv::Mat image(shape, CV_8UC1);
+        cv::randu(image, 0, 256);
+        for (int size : sizes) {
+            for (double percentile : percentiles) {
+                int count = mismatches(median(image, size, percentile), referenceMedian(image, size, percentile));
+                if (count) {
+                    std::cout << "[FAIL] " << shape.width << "x" << shape.height << " size=" << size
+                              << " percentile=" << percentile << ": " << count << " pixels differ" << std::endl;
+                    failures++;
+                }
+            }
+        }
+    }
+
+    // interleaved colour images must match filtering every channel on its own
+    for (int channels : { 2, 3, 4 }) {
+        for (auto& shape : shapes) {
+            cv::Mat image(shape, CV_MAKETYPE(CV_8U, channels));
+            cv::randu(image, 0, 256);
+            for (int size : sizes) {
+                for (double percentile : percentiles) {
+                    cv::Mat filtered = median(image, size, percentile);
+                    for (int c = 0; c < channels; c++) {
+                        int count = mismatches(channel(filtered, c), referenceMedian(channel(image, c), size, percentile));
+                        if (count) {
+                            std::cout << "[FAIL] " << shape.width << "x" << shape.height << "x" << channels
+                                      << " size=" << size << " percentile=" << percentile << " channel=" << c
+                                      << ": " << count << " pixels differ" << std::endl;
+                            failures++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    // only 8-bit images of up to 4 channels are filtered; anything else is rejected
+    for (int type : { CV_MAKETYPE(CV_8U, 5), CV_MAKETYPE(CV_8U, 8), CV_16SC1, CV_32FC1 }) {
+        cv::Mat image(9, 11, type);
+        for (int filter = 0; filter < 2; filter++) {
+            bool rejected = false;
+            try {
+                if (filter == 0) median(image, 7, 0.3);
+                else adaptiveHighBoost(image, 1.5, 40);
+            }
+            catch (const std::runtime_error&) {
+                rejected = true;
+            }
+            if (!rejected) {
+                std::cout << "[FAIL] " << (filter == 0 ? "median" : "adaptiveHighBoost") << " accepted an image of type " << type << std::endl;
+                failures++;
+            }
+        }
+    }
+    std::cout << (failures ? "[FAILED]" : "[PASSED]") << " median equivalence" << std::endl;
+    return failures != 0;
+}
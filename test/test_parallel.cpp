@@ -0,0 +1,92 @@
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include "filt.h"
+#include "parallel.h"
+
+int failures = 0;
+
+void expect(bool ok, const std::string& what) {
+    if (!ok) {
+        std::cout << "[FAIL] " << what << std::endl;
+        failures++;
+    }
+}
+
+// true if `a` and `b` hold the same bytes
+bool identical(const cv::Mat& a, const cv::Mat& b) {
+    if (a.rows != b.rows || a.cols != b.cols || a.type() != b.type()) return false;
+    size_t bytes = a.cols * a.elemSize();
+    for (int i = 0; i < a.rows; i++) {
+        if (memcmp(a.ptr<uchar>(i), b.ptr<uchar>(i), bytes)) return false;
+    }
+    return true;
+}
+
+// every filter run on the pool, with a name for the failures
+std::vector<std::pair<std::string, std::function<cv::Mat()>>> filters(const cv::Mat& image) {
+    std::vector<std::pair<std::string, std::function<cv::Mat()>>> all;
+    for (ConvStrategy strategy : { CONV_DIRECT, CONV_SEPARABLE, CONV_FFT }) {
+        std::string name = "conv strategy " + std::to_string(strategy);
+        all.push_back({ name, [&image, strategy] { return Kernel(9, 2).conv(image, strategy); } });
+        all.push_back({ name + " to CV_32F", [&image, strategy] { return Kernel(10, 3).conv(image, CV_32F, strategy); } });
+    }
+    for (int size : { 3, 5, 9 }) {
+        for (double percentile : { 0.5, 0.2 }) {
+            all.push_back({ "median " + std::to_string(size) + " at " + std::to_string(percentile),
+                            [&image, size, percentile] { return median(image, size, percentile); } });
+        }
+    }
+    all.push_back({ "adaptiveHighBoost", [&image] { return adaptiveHighBoost(image, 1.5, 40); } });
+    return all;
+}
+
+int main() {
+    // the pool is created by whichever of these threads comes first
+    std::vector<std::thread> starters;
+    std::atomic<int> started{ 0 };
+    for (int t = 0; t < 4; t++) {
+        starters.emplace_back([&] {
+            std::atomic<int> covered{ 0 };
+            parallelFor(0, 1000, [&](int begin, int end) { covered += end - begin; });
+            started += (covered == 1000 && getNumThreads() >= 1);
+        });
+    }
+    for (auto& starter : starters) starter.join();
+    expect(started == 4, "concurrent first use of the pool");
+
+    // deterministic output: the same bytes on 1 thread and on several
+    int threads = std::max(4, static_cast<int>(std::thread::hardware_concurrency()));
+    for (int type : { CV_8UC1, CV_8UC3 }) {
+        cv::Mat image(211, 157, type);
+        cv::randu(image, 0, 256);
+        for (auto& filter : filters(image)) {
+            setNumThreads(1);
+            cv::Mat serial = filter.second();
+            setNumThreads(threads);
+            expect(identical(serial, filter.second()), filter.first + " on " + std::to_string(threads) + " threads, "
+                                                       + std::to_string(image.channels()) + " channels");
+        }
+    }
+
+    // resizing the pool while other threads filter: every call finishes on the pool it started on
+    cv::Mat image(301, 233, CV_8UC1);
+    cv::randu(image, 0, 256);
+    cv::Mat expected = median(image, 7, 0.3);
+    std::atomic<bool> done{ false };
+    std::atomic<int> wrong{ 0 };
+    std::vector<std::thread> users;
+    for (int t = 0; t < 3; t++) {
+        users.emplace_back([&] {
+            while (!done) wrong += !identical(median(image, 7, 0.3), expected);
+        });
+    }
+    for (int k = 0; k < 200; k++) setNumThreads(k % 2 ? 2 : threads);
+    done = true;
+    for (auto& user : users) user.join();
+    expect(wrong == 0, "filtering while the number of threads changes");
+
+    std::cout << (failures ? "[FAILED]" : "[PASSED]") << " thread pool and deterministic parallel filters" << std::endl;
+    return failures != 0;
+}
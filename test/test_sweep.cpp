@@ -0,0 +1,68 @@
+#include <filesystem>
+#include "filt.h"
+#include "sweep.h"
+
+int failures = 0;
+
+void expect(bool ok, const std::string& what) {
+    if (!ok) {
+        std::cout << "[FAIL] " << what << std::endl;
+        failures++;
+    }
+}
+
+// FNV-1a hash of the pixels of `image`, as the sweep computes it
+unsigned long long checksum(const cv::Mat& image) {
+    unsigned long long hash = 14695981039346656037ULL;
+    size_t bytes = image.cols * image.elemSize();
+    for (int i = 0; i < image.rows; i++) {
+        const uchar* row = image.ptr<uchar>(i);
+        for (size_t j = 0; j < bytes; j++) {
+            hash ^= row[j];
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+int main() {
+    // lossless images of two sizes, more than the sweep reads ahead, with an unreadable file among them
+    std::string directory = std::filesystem::temp_directory_path().string();
+    std::vector<cv::Size> shapes = { {64, 48}, {37, 29}, {64, 48}, {37, 29}, {80, 61}, {64, 48}, {23, 17} };
+    std::vector<std::string> files;
+    std::vector<cv::Mat> images;
+    for (size_t k = 0; k < shapes.size(); k++) {
+        cv::Mat image(shapes[k], CV_8UC1);
+        cv::randu(image, 0, 256);
+        files.push_back(directory + "/sweep_" + std::to_string(k) + ".png");
+        cv::imwrite(files.back(), image);
+        images.push_back(image);
+        if (k == 2) {
+            files.push_back(directory + "/sweep_missing.png");
+            images.push_back(cv::Mat());
+        }
+    }
+
+    // every combination of every readable file, in file order, hashing what a direct call returns
+    auto results = sweep(files);
+    size_t expected = 0;
+    for (int file = 0; file < static_cast<int>(files.size()); file++) {
+        const cv::Mat& image = images[file];
+        if (!image.data) continue;
+        for (int type = 0; type < 11; type++) {
+            for (int size = 0; size < 4; size++, expected++) {
+                std::string what = files[file] + ", " + FILTER_NAME[type] + " " + std::to_string(size * 2 + 3);
+                if (expected >= results.size()) continue;
+                const SweepResult& result = results[expected];
+                cv::Mat output = type == 0 ? image : type == 2 ? median(image, size * 2 + 3) : Kernel(type, size).conv(image);
+                expect(result.file == file && result.filterType == type && result.filterSize == size, what + ": out of order");
+                expect(result.checksum == checksum(output), what + ": checksum differs");
+            }
+        }
+    }
+    expect(results.size() == expected, "sweep returned " + std::to_string(results.size()) + " results");
+
+    for (auto& file : files) std::filesystem::remove(file);
+    std::cout << (failures ? "[FAILED]" : "[PASSED]") << " sweep against direct filter calls" << std::endl;
+    return failures != 0;
+}
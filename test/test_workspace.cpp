@@ -0,0 +1,99 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "filt.h"
+
+// every heap allocation of the program goes through these replacements and is counted
+static std::atomic<long> allocations{ 0 };
+
+void* operator new(std::size_t count) {
+    allocations++;
+    if (void* p = std::malloc(count ? count : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t count) {
+    return operator new(count);
+}
+
+void* operator new(std::size_t count, std::align_val_t alignment) {
+    allocations++;
+    std::size_t align = static_cast<std::size_t>(alignment);
+    if (void* p = std::aligned_alloc(align, (count + align - 1) / align * align)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+// number of pixels in which `a` and `b` differ
+int mismatches(const cv::Mat& a, const cv::Mat& b) {
+    int count = 0;
+    int samples = a.cols * a.channels() * static_cast<int>(a.elemSize1());
+    for (int i = 0; i < a.rows; i++) {
+        for (int j = 0; j < samples; j++) {
+            count += a.ptr<uchar>(i)[j] != b.ptr<uchar>(i)[j];
+        }
+    }
+    return count;
+}
+
+int failures = 0;
+
+// runs `filter` once to let the destination and the workspace grow, then checks that
+// further calls allocate nothing and still give `expected`
+template <class Filter>
+void check(const char* name, const cv::Mat& expected, cv::Mat& dst, const Filter& filter) {
+    filter();
+    long before = allocations;
+    for (int k = 0; k < 3; k++) filter();
+    long count = allocations - before;
+    int differ = mismatches(dst, expected);
+    if (count || differ) {
+        std::cout << "[FAIL] " << name << ": " << count << " allocations, " << differ << " samples differ" << std::endl;
+        failures++;
+    }
+}
+
+int main() {
+    for (int type : { CV_8UC1, CV_8UC3 }) {
+        cv::Mat image(97, 131, type);
+        cv::randu(image, 0, 256);
+        FilterWorkspace ws;
+        cv::Mat dst;
+
+        Kernel gaussian(9, 1), laplacian(8, 2);
+        for (ConvStrategy strategy : { CONV_DIRECT, CONV_SEPARABLE, CONV_FFT }) {
+            check("conv", gaussian.conv(image, strategy), dst, [&] { gaussian.conv(image, dst, ws, -1, strategy); });
+            check("conv to CV_32F", gaussian.conv(image, CV_32F, strategy), dst,
+                  [&] { gaussian.conv(image, dst, ws, CV_32F, strategy); });
+        }
+        check("conv generic", laplacian.conv(image, CONV_DIRECT), dst, [&] { laplacian.conv(image, dst, ws, -1, CONV_DIRECT); });
+
+        for (int size : { 3, 5, 7 }) {
+            for (double percentile : { 0.5, 0.3 }) {
+                check("median", median(image, size, percentile), dst, [&] { median(image, dst, ws, size, percentile); });
+            }
+        }
+        check("adaptiveHighBoost", adaptiveHighBoost(image, 1.5, 40), dst, [&] { adaptiveHighBoost(image, dst, 1.5, 40); });
+    }
+    std::cout << (failures ? "[FAILED]" : "[PASSED]") << " steady-state filtering without allocations" << std::endl;
+    return failures != 0;
+}